@@ -0,0 +1,243 @@
+// 热路径微基准：LedController::update、命令解析与分发、状态序列化、状态存取
+// 结果以 JSON 输出到 stdout，便于按提交追踪趋势
+#include <Arduino.h>
+#include <WebSocketsServer.h>
+#include <chrono>
+#include <vector>
+#include "host_tools.h"
+#include "led_controller.h"
+#include "network.h"
+#include "status_reporter.h"
+#include "storage.h"
+#include "dsp.h"
+#include "scheduler.h"
+#include "log.h"
+#include <math.h>
+
+void setup();
+
+namespace
+{
+    struct Result
+    {
+        std::string name;
+        uint64_t iterations;
+        double nsPerOp;
+        double minBatchNsPerOp;
+        double maxBatchNsPerOp;
+    };
+
+    constexpr int BATCHES = 20;
+
+    std::vector<Result> results;
+    const char *filter = nullptr;
+
+    double nowNs()
+    {
+        using namespace std::chrono;
+        return (double)duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+    }
+
+    // 分批计时：总均值之外记录最快/最慢批次，用于判断噪声
+    template <typename F>
+    void measure(const char *name, uint64_t iterations, F &&fn)
+    {
+        if (filter && !strstr(name, filter))
+            return;
+        uint64_t perBatch = max<uint64_t>(1, iterations / BATCHES);
+        // 预热
+        for (uint64_t i = 0; i < perBatch; ++i)
+            fn();
+        double total = 0, minB = 1e300, maxB = 0;
+        for (int b = 0; b < BATCHES; ++b)
+        {
+            double t0 = nowNs();
+            for (uint64_t i = 0; i < perBatch; ++i)
+                fn();
+            double per = (nowNs() - t0) / (double)perBatch;
+            total += per;
+            minB = min(minB, per);
+            maxB = max(maxB, per);
+        }
+        results.push_back(Result{name, perBatch * BATCHES, total / BATCHES, minB, maxB});
+    }
+
+    void benchLed(uint64_t n)
+    {
+        auto step = []
+        {
+            FakeClock::advanceMicros(1000);
+            LedController::update();
+        };
+        LedController::setModeOn();
+        measure("led_update_on", n, step);
+        LedController::setModeOff();
+        measure("led_update_off", n, step);
+        LedController::setModeBlink(5);
+        measure("led_update_blink", n, step);
+        LedController::setModeBreathe(1500);
+        measure("led_update_breathe", n, step);
+        LedController::enterBreatheWait();
+        measure("led_update_breathe_wait", n, step);
+        LedController::onClientConnected();
+    }
+
+    void benchCommands(WebSocketsServer *ws, uint64_t n)
+    {
+        measure("cmd_get_status", n, [ws]
+                { ws->fakeText(0, "{\"cmd\":\"get_status\"}"); });
+        measure("cmd_set_brightness", n / 10, [ws]
+                { ws->fakeText(0, "{\"cmd\":\"set_brightness\",\"duty\":200}"); });
+        measure("cmd_set_mode_blink", n / 10, [ws]
+                { ws->fakeText(0, "{\"cmd\":\"set_mode\",\"mode\":\"blink\",\"hz\":3}"); });
+        measure("cmd_get_metrics", n / 10, [ws]
+                { ws->fakeText(0, "{\"cmd\":\"get_metrics\"}"); });
+        measure("cmd_invalid_json", n, [ws]
+                { ws->fakeText(0, "{\"cmd\":"); });
+        measure("cmd_unknown", n, [ws]
+                { ws->fakeText(0, "{\"cmd\":\"nope\"}"); });
+
+        // 流式帧：每帧 1 个样本，时间戳递增；缓冲满后走丢弃最旧样本的路径
+        ws->fakeText(0, "{\"cmd\":\"stream_start\"}");
+        uint32_t t = 0;
+        measure("stream_frame", n, [ws, &t]
+                {
+                    t += 10;
+                    uint8_t frame[7] = {0x01, 1, (uint8_t)t, (uint8_t)(t >> 8), (uint8_t)(t >> 16), (uint8_t)(t >> 24), 128};
+                    ws->fakeBinary(0, frame, sizeof(frame)); });
+        ws->fakeText(0, "{\"cmd\":\"stream_stop\"}");
+    }
+
+    void benchStatus(uint64_t n)
+    {
+        measure("status_broadcast_cached", n, []
+                { StatusReporter::broadcast(); });
+        measure("status_broadcast_rebuild", n, []
+                {
+                    StatusReporter::invalidate();
+                    StatusReporter::broadcast(); });
+    }
+
+    void benchStorage(uint64_t n)
+    {
+        measure("storage_save", n, []
+                { Storage::saveState(); });
+        measure("storage_load", n, []
+                { Storage::loadState(); });
+    }
+
+    // 规则池占满（间隔互不相同，分布在各层时间轮上）时每秒推进一格的开销，含到期动作（写 state.json 与广播）
+    void benchScheduler(uint64_t n)
+    {
+        Scheduler::clear();
+        for (int i = 0; i < Scheduler::MAX_RULES; ++i)
+        {
+            Scheduler::Rule r = {};
+            r.repeat = Scheduler::REPEAT_EVERY;
+            r.at = 7u + (uint32_t)i * 997u;
+            r.action = Scheduler::ACT_BRIGHTNESS;
+            r.duty = (uint8_t)i;
+            Scheduler::add(r);
+        }
+        measure("sched_tick_full", n, []
+                {
+                    FakeClock::advanceMicros(1000000);
+                    Scheduler::loop(); });
+        Scheduler::clear();
+        measure("sched_tick_empty", n, []
+                {
+                    FakeClock::advanceMicros(1000000);
+                    Scheduler::loop(); });
+    }
+
+    // 调用处写一条日志记录的开销，以及空闲任务格式化一条记录的开销（不含串口发送）
+    void benchLog(uint64_t n)
+    {
+        measure("log_write_2args", n, []
+                { Log::write(Log::STORAGE_SAVED, 123, 4567); });
+        Log::Record r = {};
+        r.id = Log::STORAGE_SAVED;
+        r.argc = 2;
+        r.args[0] = 123;
+        r.args[1] = 4567;
+        char line[160];
+        measure("log_format", n, [&]
+                { Log::format(r, line, sizeof(line)); });
+    }
+
+    // 合成输入：200 Hz 正弦 + 伪随机噪声 + 直流偏置，8 kHz 采样，与设备上一块的长度相同
+    void benchDsp(uint64_t n)
+    {
+        constexpr size_t BLOCK = 128;
+        static int16_t in[BLOCK], out[BLOCK], re[Dsp::FFT_N], im[Dsp::FFT_N];
+        uint32_t seed = 12345;
+        for (size_t i = 0; i < BLOCK; ++i)
+        {
+            seed = seed * 1103515245u + 12345u;
+            int noise = (int)((seed >> 16) & 0x7FF) - 1024;
+            in[i] = (int16_t)(2000 + 12000.0 * sin(2 * M_PI * 200.0 * i / 8000.0) + noise);
+        }
+
+        Dsp::DcBlocker dc = {};
+        measure("dsp_dc_remove", n, [&]
+                { Dsp::dcRemove(dc, in, out, BLOCK); });
+        Dsp::Envelope env = {};
+        measure("dsp_envelope", n, [&]
+                { Dsp::envelope(env, out, BLOCK, 8000, 100); });
+        measure("dsp_fft64", n, [&]
+                {
+                    memcpy(re, out, sizeof(re));
+                    memset(im, 0, sizeof(im));
+                    Dsp::fftQ15(re, im); });
+
+        Dsp::AudioState st = {};
+        Dsp::AudioConfig cfg = {8000, 100, 32, false, 1, 4};
+        measure("dsp_pipeline_block", n, [&]
+                { Dsp::processBlock(st, cfg, in, BLOCK, out); });
+        cfg.useFft = true;
+        measure("dsp_pipeline_block_fft", n, [&]
+                { Dsp::processBlock(st, cfg, in, BLOCK, out); });
+    }
+
+    void printResults(uint64_t n)
+    {
+        printf("{\"suite\":\"host_bench\",\"unit\":\"ns_per_op\",\"iterations\":%llu,\"results\":[", (unsigned long long)n);
+        for (size_t i = 0; i < results.size(); ++i)
+        {
+            const Result &r = results[i];
+            printf("%s{\"name\":\"%s\",\"iterations\":%llu,\"ns_per_op\":%.1f,\"min_batch\":%.1f,\"max_batch\":%.1f}",
+                   i ? "," : "", r.name.c_str(), (unsigned long long)r.iterations, r.nsPerOp, r.minBatchNsPerOp, r.maxBatchNsPerOp);
+        }
+        printf("]}\n");
+    }
+}
+
+int runBench(int argc, char **argv)
+{
+    uint64_t n = 100000;
+    for (int i = 0; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc)
+            n = strtoull(argv[++i], nullptr, 10);
+        else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc)
+            filter = argv[++i];
+    }
+
+    // 虚拟时钟：LED 波形按固定步长推进，基准结果与墙钟无关
+    FakeClock::setVirtual(true);
+    Serial.muted = true;
+    setup();
+    WebSocketsServer *ws = Network::getWebSocketServer();
+    ws->fakeConnect(0);
+
+    benchLed(n);
+    benchCommands(ws, n);
+    benchStatus(n);
+    benchStorage(max<uint64_t>(1, n / 100));
+    benchDsp(n);
+    benchScheduler(n);
+    benchLog(n);
+
+    printResults(n);
+    return 0;
+}
@@ -0,0 +1,202 @@
+#pragma once
+// 主机（native）构建用的 Arduino 核心替身：只实现固件实际用到的接口
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+#include <algorithm>
+
+using std::max;
+using std::min;
+
+#ifndef constrain
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+#endif
+
+// glibc 2.38 之前没有 strlcpy
+#if defined(__GLIBC__) && (__GLIBC__ == 2 && __GLIBC_MINOR__ < 38)
+inline size_t strlcpy(char *dst, const char *src, size_t size)
+{
+    size_t len = strlen(src);
+    if (size)
+    {
+        size_t n = len < size - 1 ? len : size - 1;
+        memcpy(dst, src, n);
+        dst[n] = '\0';
+    }
+    return len;
+}
+#endif
+
+#define PROGMEM
+#define PGM_P const char *
+#define IRAM_ATTR
+#define RTC_NOINIT_ATTR
+
+// 时间基准：默认跟随单调时钟；replay/基准测试可切换为虚拟时钟
+namespace FakeClock
+{
+    void setVirtual(bool enabled);
+    void setMicros(uint64_t us);
+    void advanceMicros(uint64_t us);
+    // 给本实例的时钟叠加固定偏移（模拟多设备时钟不一致）
+    void setOffsetMicros(int64_t us);
+    uint64_t nowMicros();
+}
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void yield();
+// 硬件随机数（Arduino.h 经 esp_system.h 提供）
+uint32_t esp_random();
+
+class String
+{
+public:
+    String() {}
+    String(const char *s) : s_(s ? s : "") {}
+    String(const std::string &s) : s_(s) {}
+    String(char c) : s_(1, c) {}
+    String(int v) : s_(std::to_string(v)) {}
+    String(unsigned int v) : s_(std::to_string(v)) {}
+    String(long v) : s_(std::to_string(v)) {}
+    String(unsigned long v) : s_(std::to_string(v)) {}
+    const char *c_str() const { return s_.c_str(); }
+    unsigned int length() const { return (unsigned int)s_.size(); }
+    long toInt() const { return strtol(s_.c_str(), nullptr, 10); }
+    bool reserve(unsigned int n) { s_.reserve(n); return true; }
+    String &operator+=(const String &o) { s_ += o.s_; return *this; }
+    String &operator+=(const char *o) { s_ += o; return *this; }
+    String &operator+=(char c) { s_ += c; return *this; }
+    bool concat(const char *o, unsigned int n) { s_.append(o, n); return true; }
+    bool operator==(const char *o) const { return s_ == o; }
+    bool operator==(const String &o) const { return s_ == o.s_; }
+    char operator[](unsigned int i) const { return s_[i]; }
+    friend String operator+(const String &a, const String &b) { return String(a.s_ + b.s_); }
+    friend String operator+(const String &a, const char *b) { return String(a.s_ + b); }
+
+private:
+    std::string s_;
+};
+
+class Print
+{
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t *buf, size_t n)
+    {
+        size_t i = 0;
+        for (; i < n; ++i)
+            write(buf[i]);
+        return i;
+    }
+    size_t print(const char *s) { return write((const uint8_t *)s, strlen(s)); }
+    size_t print(const String &s) { return print(s.c_str()); }
+    size_t print(int v) { return printf("%d", v); }
+    size_t println(const char *s = "") { return print(s) + print("\n"); }
+    size_t println(const String &s) { return println(s.c_str()); }
+    size_t println(int v) { return print(v) + print("\n"); }
+    size_t printf(const char *fmt, ...) __attribute__((format(printf, 2, 3)))
+    {
+        char buf[256];
+        va_list ap;
+        va_start(ap, fmt);
+        int n = vsnprintf(buf, sizeof(buf), fmt, ap);
+        va_end(ap);
+        if (n < 0)
+            return 0;
+        return write((const uint8_t *)buf, (size_t)min(n, (int)sizeof(buf) - 1));
+    }
+};
+
+class IPAddress : public Print
+{
+public:
+    IPAddress(uint8_t a = 0, uint8_t b = 0, uint8_t c = 0, uint8_t d = 0) : addr_{a, b, c, d} {}
+    uint8_t operator[](int i) const { return addr_[i]; }
+    operator uint32_t() const { return (uint32_t)addr_[0] | ((uint32_t)addr_[1] << 8) | ((uint32_t)addr_[2] << 16) | ((uint32_t)addr_[3] << 24); }
+    String toString() const
+    {
+        char buf[16];
+        snprintf(buf, sizeof(buf), "%u.%u.%u.%u", addr_[0], addr_[1], addr_[2], addr_[3]);
+        return String(buf);
+    }
+    size_t write(uint8_t) override { return 0; }
+
+private:
+    uint8_t addr_[4];
+};
+
+// Serial 直接写到 stderr，保持 stdout 干净用于输出机器可读结果
+class HardwareSerial : public Print
+{
+public:
+    void begin(unsigned long) {}
+    size_t write(uint8_t c) override { return muted ? 1 : fwrite(&c, 1, 1, stderr); }
+    size_t write(const uint8_t *buf, size_t n) override { return muted ? n : fwrite(buf, 1, n, stderr); }
+    size_t println(const IPAddress &ip) { return Print::println(ip.toString()); }
+    using Print::println;
+
+    // 测试钩子：基准测试时静音日志输出
+    bool muted = false;
+};
+extern HardwareSerial Serial;
+
+// LEDC：记录最后写入的占空比，供测试读取
+void ledcSetup(uint8_t channel, uint32_t freq, uint8_t bits);
+void ledcAttachPin(uint8_t pin, uint8_t channel);
+void ledcWrite(uint8_t channel, uint32_t duty);
+uint32_t fakeLedcLastDuty(uint8_t channel);
+uint32_t fakeLedcWriteCount();
+
+// 其余输出外设（LedOutput 各后端）：只记录最后写入的值
+#define LOW 0x0
+#define HIGH 0x1
+#define OUTPUT 0x03
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+uint32_t sigmaDeltaSetup(uint8_t pin, uint8_t channel, uint32_t freq);
+void sigmaDeltaWrite(uint8_t channel, uint8_t duty);
+
+typedef struct
+{
+    union
+    {
+        struct
+        {
+            uint32_t duration0 : 15;
+            uint32_t level0 : 1;
+            uint32_t duration1 : 15;
+            uint32_t level1 : 1;
+        };
+        uint32_t val;
+    };
+} rmt_data_t;
+typedef struct rmt_obj_s rmt_obj_t;
+typedef enum
+{
+    RMT_MEM_64 = 1,
+    RMT_MEM_128 = 2,
+} rmt_reserve_memsize_t;
+#define RMT_TX_MODE true
+rmt_obj_t *rmtInit(int pin, bool tx_not_rx, rmt_reserve_memsize_t memsize);
+float rmtSetTick(rmt_obj_t *rmt, float tick);
+bool rmtWrite(rmt_obj_t *rmt, rmt_data_t *data, size_t size);
+
+class EspClass
+{
+public:
+    uint32_t getFreeHeap();
+    uint32_t getMinFreeHeap();
+    uint32_t getCycleCount();
+    uint32_t getCpuFreqMHz() { return 160; }
+    // 主机上不重启，只计数（测试据此判断是否请求了重启）
+    void restart() { fakeRestarts++; }
+    uint32_t fakeRestarts = 0;
+};
+extern EspClass ESP;
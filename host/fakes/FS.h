@@ -0,0 +1,45 @@
+#pragma once
+// 主机构建的 fs::File / fs::FS 替身，基于 stdio
+#include <Arduino.h>
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+namespace fs
+{
+    class File : public Print
+    {
+    public:
+        File(FILE *f = nullptr) : f_(f) {}
+        explicit operator bool() const { return f_ != nullptr; }
+        size_t write(uint8_t c) override { return f_ ? fwrite(&c, 1, 1, f_) : 0; }
+        size_t write(const uint8_t *buf, size_t n) override { return f_ ? fwrite(buf, 1, n, f_) : 0; }
+        int read() { return f_ ? fgetc(f_) : -1; }
+        size_t read(uint8_t *buf, size_t n) { return f_ ? fread(buf, 1, n, f_) : 0; }
+        size_t readBytes(char *buf, size_t n) { return read((uint8_t *)buf, n); }
+        int available() { return f_ && !feof(f_) ? 1 : 0; }
+        size_t size();
+        void close()
+        {
+            if (f_)
+                fclose(f_);
+            f_ = nullptr;
+        }
+
+    private:
+        FILE *f_;
+    };
+
+    class FS
+    {
+    public:
+        File open(const char *path, const char *mode = FILE_READ);
+        bool exists(const char *path);
+        bool remove(const char *path);
+
+    protected:
+        std::string root_;
+    };
+}
+using fs::File;
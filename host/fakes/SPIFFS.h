@@ -0,0 +1,13 @@
+#pragma once
+// 主机构建的 SPIFFS 替身：以临时目录作为文件系统根
+#include <Arduino.h>
+#include <FS.h>
+
+class SPIFFSFS : public fs::FS
+{
+public:
+    bool begin(bool formatOnFail = false);
+    // 测试钩子：指定后备目录（默认在 /tmp 下创建）
+    void fakeSetRoot(const char *dir);
+};
+extern SPIFFSFS SPIFFS;
@@ -0,0 +1,77 @@
+#pragma once
+// 主机构建的 WebServer 替身：注册的处理函数可由测试直接调用
+#include <Arduino.h>
+#include <functional>
+
+enum HTTPMethod
+{
+    HTTP_ANY,
+    HTTP_GET,
+    HTTP_POST
+};
+
+#define CONTENT_LENGTH_UNKNOWN ((size_t)-1)
+#define HTTP_UPLOAD_BUFLEN 1436
+
+enum HTTPUploadStatus
+{
+    UPLOAD_FILE_START,
+    UPLOAD_FILE_WRITE,
+    UPLOAD_FILE_END,
+    UPLOAD_FILE_ABORTED
+};
+
+struct HTTPUpload
+{
+    HTTPUploadStatus status;
+    String filename;
+    String name;
+    String type;
+    size_t totalSize;
+    size_t currentSize;
+    uint8_t buf[HTTP_UPLOAD_BUFLEN];
+};
+
+class WebServer
+{
+public:
+    typedef std::function<void(void)> THandlerFunction;
+    explicit WebServer(int port = 80) : port_(port) {}
+    void begin() {}
+    void handleClient() {}
+    void on(const char *uri, THandlerFunction fn);
+    void on(const char *uri, HTTPMethod method, THandlerFunction fn);
+    void on(const char *uri, HTTPMethod method, THandlerFunction fn, THandlerFunction ufn);
+    HTTPUpload &upload() { return upload_; }
+    String arg(const char *name) const;
+    bool hasArg(const char *name) const;
+    void send(int code, const char *contentType = nullptr, const String &content = String());
+    void send_P(int code, PGM_P contentType, PGM_P content, size_t contentLength);
+    void send_P(int code, PGM_P contentType, PGM_P content) { send_P(code, contentType, content, strlen(content)); }
+    void setContentLength(size_t len) { contentLength_ = len; }
+    void sendContent(const char *content, size_t len);
+    void sendContent(const String &content) { sendContent(content.c_str(), content.length()); }
+
+    // 测试钩子：模拟一次请求，返回响应体
+    bool fakeRequest(const char *uri, int *code, std::string *body);
+    // 测试钩子：模拟 multipart 上传，按 HTTP_UPLOAD_BUFLEN 分块调用上传处理函数，query 形如 "a=1&b=2"；
+    // 每块之后调用 between（可为空），用于在上传过程中推进其他逻辑
+    bool fakeUpload(const char *uri, const char *query, const uint8_t *data, size_t len,
+                    int *code, std::string *body, std::function<void()> between = nullptr);
+
+private:
+    int port_;
+    size_t contentLength_ = 0;
+    int lastCode_ = 0;
+    std::string body_;
+    struct Route
+    {
+        std::string uri;
+        THandlerFunction fn;
+        THandlerFunction ufn;
+    };
+    HTTPUpload upload_;
+    std::string query_;
+    Route routes_[16];
+    int routeCount_ = 0;
+};
@@ -0,0 +1,83 @@
+#pragma once
+// 主机构建的 WebSocketsServer 替身：
+// - 默认进程内模式：记录发送的帧并允许测试注入事件
+// - 套接字模式（fakeEnableSockets）：begin() 真正监听 TCP 端口，loop() 处理 RFC 6455 握手与帧
+#include <Arduino.h>
+#include <functional>
+
+#ifndef WEBSOCKETS_SERVER_CLIENT_MAX
+#define WEBSOCKETS_SERVER_CLIENT_MAX 5
+#endif
+
+typedef enum
+{
+    WStype_ERROR,
+    WStype_DISCONNECTED,
+    WStype_CONNECTED,
+    WStype_TEXT,
+    WStype_BIN,
+    WStype_FRAGMENT_TEXT_START,
+    WStype_FRAGMENT_BIN_START,
+    WStype_FRAGMENT,
+    WStype_FRAGMENT_FIN,
+    WStype_PING,
+    WStype_PONG,
+} WStype_t;
+
+class WebSocketsServer
+{
+public:
+    typedef std::function<void(uint8_t num, WStype_t type, uint8_t *payload, size_t length)> WebSocketServerEvent;
+
+    explicit WebSocketsServer(uint16_t port) : port_(port)
+    {
+        for (int &fd : fds_)
+            fd = -1;
+    }
+    virtual ~WebSocketsServer() {}
+    void begin();
+    void loop();
+    void onEvent(WebSocketServerEvent cb) { cb_ = cb; }
+
+    bool sendTXT(uint8_t num, const uint8_t *payload, size_t length = 0);
+    bool sendTXT(uint8_t num, const char *payload, size_t length = 0) { return sendTXT(num, (const uint8_t *)payload, length); }
+    bool sendTXT(uint8_t num, String &payload) { return sendTXT(num, payload.c_str(), payload.length()); }
+    bool broadcastTXT(const uint8_t *payload, size_t length = 0);
+    bool broadcastTXT(const char *payload, size_t length = 0) { return broadcastTXT((const uint8_t *)payload, length); }
+    bool broadcastTXT(String &payload) { return broadcastTXT(payload.c_str(), payload.length()); }
+    bool sendBIN(uint8_t num, const uint8_t *payload, size_t length);
+    uint8_t connectedClients(bool ping = false);
+    bool clientIsConnected(uint8_t num);
+    void disconnect(uint8_t num);
+
+    // 测试钩子
+    // 此后创建的服务器使用真实套接字；port 非 0 时替换构造时给定的端口（81 需要特权）
+    static void fakeEnableSockets(uint16_t port);
+    // url 为握手请求路径（可带查询串），与真实库一样作为 WStype_CONNECTED 的负载传给回调
+    void fakeConnect(uint8_t num, const char *url = nullptr);
+    void fakeDisconnect(uint8_t num);
+    void fakeText(uint8_t num, const char *text);
+    void fakeBinary(uint8_t num, const uint8_t *data, size_t len);
+    uint32_t fakeSentFrames() const { return sent_; }
+    uint32_t fakeSentBytes() const { return sentBytes_; }
+    const std::string &fakeLastText() const { return last_; }
+    void fakeSetSink(std::function<void(uint8_t num, const uint8_t *payload, size_t len, bool bin)> sink) { sink_ = sink; }
+
+protected:
+    void acceptClients();
+    void pollClient(uint8_t num);
+    void closeClient(uint8_t num);
+    bool writeFrame(uint8_t num, uint8_t opcode, const uint8_t *payload, size_t length);
+
+    uint16_t port_;
+    int listenFd_ = -1;
+    int fds_[WEBSOCKETS_SERVER_CLIENT_MAX];
+    bool handshaken_[WEBSOCKETS_SERVER_CLIENT_MAX] = {};
+    std::string inbuf_[WEBSOCKETS_SERVER_CLIENT_MAX];
+    WebSocketServerEvent cb_;
+    bool connected_[WEBSOCKETS_SERVER_CLIENT_MAX] = {};
+    uint32_t sent_ = 0;
+    uint32_t sentBytes_ = 0;
+    std::string last_;
+    std::function<void(uint8_t, const uint8_t *, size_t, bool)> sink_;
+};
@@ -0,0 +1,33 @@
+#pragma once
+// 主机构建的 WiFi 替身：station 数与 RSSI 可由测试设定
+#include <Arduino.h>
+
+typedef enum
+{
+    WL_IDLE_STATUS = 0,
+    WL_CONNECTED = 3,
+    WL_DISCONNECTED = 6
+} wl_status_t;
+
+typedef enum
+{
+    WIFI_OFF = 0,
+    WIFI_STA = 1,
+    WIFI_AP = 2,
+    WIFI_AP_STA = 3
+} wifi_mode_t;
+
+class WiFiClass
+{
+public:
+    bool softAP(const char *, const char * = nullptr) { return true; }
+    bool mode(wifi_mode_t) { return true; }
+    wl_status_t begin(const char *, const char * = nullptr) { return WL_DISCONNECTED; }
+    IPAddress softAPIP() { return IPAddress(127, 0, 0, 1); }
+    uint8_t softAPgetStationNum() { return stations; }
+    wl_status_t status() { return WL_DISCONNECTED; }
+    int8_t RSSI() { return 0; }
+
+    uint8_t stations = 0;
+};
+extern WiFiClass WiFi;
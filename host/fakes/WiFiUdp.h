@@ -0,0 +1,39 @@
+#pragma once
+// 主机构建的 WiFiUDP 替身：基于真实 UDP 套接字，组播走回环接口，
+// 同一台机器上的多个主机实例可以互相收发（SO_REUSEPORT 共享端口）
+#include <Arduino.h>
+
+class WiFiUDP
+{
+public:
+    ~WiFiUDP() { stop(); }
+
+    uint8_t begin(uint16_t port);
+    uint8_t beginMulticast(IPAddress address, uint16_t port);
+    void stop();
+
+    int beginPacket(IPAddress ip, uint16_t port);
+    int beginMulticastPacket();
+    size_t write(const uint8_t *buf, size_t len);
+    int endPacket();
+
+    // 非阻塞：无数据时返回 0
+    int parsePacket();
+    int read(uint8_t *buf, size_t len);
+    IPAddress remoteIP() { return remoteIP_; }
+    uint16_t remotePort() { return remotePort_; }
+
+private:
+    int fd_ = -1;
+    uint16_t port_ = 0;
+    uint32_t multicastAddr_ = 0;
+    uint32_t txAddr_ = 0;
+    uint16_t txPort_ = 0;
+    uint8_t tx_[1460];
+    size_t txLen_ = 0;
+    uint8_t rx_[1460];
+    size_t rxLen_ = 0;
+    size_t rxPos_ = 0;
+    IPAddress remoteIP_;
+    uint16_t remotePort_ = 0;
+};
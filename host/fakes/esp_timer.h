@@ -0,0 +1,8 @@
+#pragma once
+// 主机构建的 esp_timer 替身：64 位微秒时钟，与 FakeClock 一致（含注入的偏移）
+#include <Arduino.h>
+
+inline int64_t esp_timer_get_time()
+{
+    return (int64_t)FakeClock::nowMicros();
+}
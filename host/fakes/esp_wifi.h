@@ -0,0 +1,25 @@
+#pragma once
+// 主机构建的 esp_wifi 替身：只提供 AP station 列表查询
+#include <stdint.h>
+
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_WIFI_MAX_CONN_NUM 10
+
+typedef struct
+{
+    uint8_t mac[6];
+    int8_t rssi;
+} wifi_sta_info_t;
+
+typedef struct
+{
+    wifi_sta_info_t sta[ESP_WIFI_MAX_CONN_NUM];
+    int num;
+} wifi_sta_list_t;
+
+esp_err_t esp_wifi_ap_get_sta_list(wifi_sta_list_t *sta);
+// 测试钩子：设定模拟 station 的 RSSI 列表
+void fakeWifiSetStations(const int8_t *rssi, int num);
+uint32_t fakeWifiStaListCalls();
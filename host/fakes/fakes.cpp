@@ -0,0 +1,397 @@
+// 主机（native）构建的 HAL 替身实现
+#include <Arduino.h>
+#include <WiFi.h>
+#include <SPIFFS.h>
+#include <WebServer.h>
+#include <WebSocketsServer.h>
+#include <esp_heap_caps.h>
+#include <esp_wifi.h>
+#include <freertos/task.h>
+#include <driver/adc.h>
+#include <deque>
+#include <chrono>
+#include <thread>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <ftw.h>
+#include <unistd.h>
+
+// ---- 时钟 ----
+namespace FakeClock
+{
+    static bool virtualMode = false;
+    static uint64_t virtualUs = 0;
+    static int64_t offsetUs = 0;
+    static const auto epoch = std::chrono::steady_clock::now();
+
+    void setVirtual(bool enabled) { virtualMode = enabled; }
+    void setMicros(uint64_t us) { virtualUs = us; }
+    void advanceMicros(uint64_t us) { virtualUs += us; }
+    void setOffsetMicros(int64_t us) { offsetUs = us; }
+
+    uint64_t nowMicros()
+    {
+        if (virtualMode)
+            return virtualUs + offsetUs;
+        auto d = std::chrono::steady_clock::now() - epoch;
+        return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(d).count() + offsetUs;
+    }
+}
+
+unsigned long millis() { return (unsigned long)(FakeClock::nowMicros() / 1000); }
+unsigned long micros() { return (unsigned long)FakeClock::nowMicros(); }
+uint32_t esp_random() { return (uint32_t)rand() ^ ((uint32_t)rand() << 16); }
+
+void delay(unsigned long ms)
+{
+    if (FakeClock::virtualMode)
+        FakeClock::advanceMicros((uint64_t)ms * 1000);
+    else
+        std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void yield() {}
+
+HardwareSerial Serial;
+EspClass ESP;
+WiFiClass WiFi;
+SPIFFSFS SPIFFS;
+
+// ---- LEDC ----
+static uint32_t ledcDuty[16];
+static uint32_t ledcWrites = 0;
+
+void ledcSetup(uint8_t, uint32_t, uint8_t) {}
+void ledcAttachPin(uint8_t, uint8_t) {}
+
+void ledcWrite(uint8_t channel, uint32_t duty)
+{
+    if (channel < 16)
+        ledcDuty[channel] = duty;
+    ledcWrites++;
+}
+
+uint32_t fakeLedcLastDuty(uint8_t channel) { return channel < 16 ? ledcDuty[channel] : 0; }
+uint32_t fakeLedcWriteCount() { return ledcWrites; }
+
+// ---- GPIO / sigma-delta / RMT ----
+static uint8_t gpioLevel[32];
+static uint8_t sdDuty[8];
+struct rmt_obj_s
+{
+    int pin;
+};
+static rmt_obj_s rmtObj;
+
+void pinMode(uint8_t, uint8_t) {}
+void digitalWrite(uint8_t pin, uint8_t val)
+{
+    if (pin < 32)
+        gpioLevel[pin] = val;
+}
+uint32_t sigmaDeltaSetup(uint8_t, uint8_t, uint32_t freq) { return freq; }
+void sigmaDeltaWrite(uint8_t channel, uint8_t duty)
+{
+    if (channel < 8)
+        sdDuty[channel] = duty;
+}
+rmt_obj_t *rmtInit(int pin, bool, rmt_reserve_memsize_t)
+{
+    rmtObj.pin = pin;
+    return &rmtObj;
+}
+float rmtSetTick(rmt_obj_t *, float tick) { return tick; }
+bool rmtWrite(rmt_obj_t *, rmt_data_t *, size_t) { return true; }
+
+// ---- ESP / heap ----
+uint32_t EspClass::getFreeHeap() { return 200 * 1024; }
+uint32_t EspClass::getMinFreeHeap() { return 200 * 1024; }
+uint32_t EspClass::getCycleCount() { return (uint32_t)(FakeClock::nowMicros() * getCpuFreqMHz()); }
+
+size_t heap_caps_get_largest_free_block(uint32_t) { return 128 * 1024; }
+size_t heap_caps_get_free_size(uint32_t) { return 200 * 1024; }
+
+// ---- esp_wifi ----
+static int8_t staRssi[ESP_WIFI_MAX_CONN_NUM];
+static int staNum = 0;
+static uint32_t staListCalls = 0;
+
+esp_err_t esp_wifi_ap_get_sta_list(wifi_sta_list_t *sta)
+{
+    staListCalls++;
+    sta->num = staNum;
+    for (int i = 0; i < staNum; ++i)
+        sta->sta[i].rssi = staRssi[i];
+    return ESP_OK;
+}
+
+void fakeWifiSetStations(const int8_t *rssi, int num)
+{
+    staNum = min(num, ESP_WIFI_MAX_CONN_NUM);
+    for (int i = 0; i < staNum; ++i)
+        staRssi[i] = rssi[i];
+    WiFi.stations = (uint8_t)staNum;
+}
+
+uint32_t fakeWifiStaListCalls() { return staListCalls; }
+
+// ---- FreeRTOS ----
+static int mainTaskMarker;
+
+TaskHandle_t xTaskGetCurrentTaskHandle() { return &mainTaskMarker; }
+
+BaseType_t xTaskCreate(TaskFunction_t, const char *, uint32_t, void *, int, TaskHandle_t *handle)
+{
+    if (handle)
+        *handle = nullptr;
+    return pdPASS;
+}
+
+void vTaskDelay(TickType_t ticks) { delay(ticks); }
+void vTaskSuspend(TaskHandle_t) {}
+void vTaskResume(TaskHandle_t) {}
+
+// ---- 连续 ADC：注入的样本排队，read 时按 4 字节结果取出 ----
+static bool adcStarted = false;
+static uint8_t adcChannel = 0;
+static std::deque<uint32_t> adcQueue;
+
+esp_err_t adc_digi_initialize(const adc_digi_init_config_t *) { return ESP_OK; }
+
+esp_err_t adc_digi_controller_configure(const adc_digi_configuration_t *config)
+{
+    if (config && config->pattern_num > 0)
+        adcChannel = config->adc_pattern[0].channel;
+    return ESP_OK;
+}
+
+esp_err_t adc_digi_start()
+{
+    adcStarted = true;
+    return ESP_OK;
+}
+
+esp_err_t adc_digi_stop()
+{
+    adcStarted = false;
+    adcQueue.clear();
+    return ESP_OK;
+}
+
+esp_err_t adc_digi_deinitialize() { return ESP_OK; }
+
+esp_err_t adc_digi_read_bytes(uint8_t *buf, uint32_t length_max, uint32_t *out_length, uint32_t)
+{
+    *out_length = 0;
+    if (!adcStarted)
+        return ESP_ERR_INVALID_STATE;
+    while (*out_length + SOC_ADC_DIGI_RESULT_BYTES <= length_max && !adcQueue.empty())
+    {
+        memcpy(buf + *out_length, &adcQueue.front(), SOC_ADC_DIGI_RESULT_BYTES);
+        adcQueue.pop_front();
+        *out_length += SOC_ADC_DIGI_RESULT_BYTES;
+    }
+    return *out_length ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+void fakeAdcFeed(const uint16_t *raw, size_t n)
+{
+    if (!adcStarted)
+        return;
+    for (size_t i = 0; i < n; ++i)
+    {
+        adc_digi_output_data_t d = {};
+        d.type2.data = raw[i] & 0xFFF;
+        d.type2.channel = adcChannel;
+        adcQueue.push_back(d.val);
+    }
+}
+
+// ---- SPIFFS：以临时目录作为根 ----
+namespace fs
+{
+    size_t File::size()
+    {
+        if (!f_)
+            return 0;
+        long pos = ftell(f_);
+        fseek(f_, 0, SEEK_END);
+        long end = ftell(f_);
+        fseek(f_, pos, SEEK_SET);
+        return end < 0 ? 0 : (size_t)end;
+    }
+
+    File FS::open(const char *path, const char *mode)
+    {
+        std::string full = root_ + path;
+        return File(fopen(full.c_str(), mode));
+    }
+
+    bool FS::exists(const char *path)
+    {
+        struct stat st;
+        return stat((root_ + path).c_str(), &st) == 0;
+    }
+
+    bool FS::remove(const char *path)
+    {
+        return ::remove((root_ + path).c_str()) == 0;
+    }
+}
+
+// 自动创建的临时目录在进程退出时删除；只由创建它的进程删除，fork 出的子进程退出时不会误删
+static std::string tempRoot;
+static pid_t tempRootPid = 0;
+
+static int removeEntry(const char *path, const struct stat *, int, struct FTW *)
+{
+    return ::remove(path);
+}
+
+static void removeTempRoot()
+{
+    if (!tempRoot.empty() && getpid() == tempRootPid)
+        nftw(tempRoot.c_str(), removeEntry, 8, FTW_DEPTH | FTW_PHYS);
+}
+
+bool SPIFFSFS::begin(bool)
+{
+    if (!root_.empty())
+        return true;
+    // 优先使用 STUPID_LED_FS 指定的目录，否则创建一个临时目录
+    const char *env = getenv("STUPID_LED_FS");
+    if (env && *env)
+    {
+        root_ = env;
+        return true;
+    }
+    if (tempRoot.empty() || tempRootPid != getpid())
+    {
+        char tmpl[] = "/tmp/stupid_led_fsXXXXXX";
+        if (!mkdtemp(tmpl))
+            return false;
+        if (tempRoot.empty())
+            atexit(removeTempRoot);
+        tempRoot = tmpl;
+        tempRootPid = getpid();
+    }
+    root_ = tempRoot;
+    return true;
+}
+
+void SPIFFSFS::fakeSetRoot(const char *dir) { root_ = dir ? dir : ""; }
+
+// ---- WebServer ----
+void WebServer::on(const char *uri, THandlerFunction fn) { on(uri, HTTP_ANY, fn); }
+
+void WebServer::on(const char *uri, HTTPMethod, THandlerFunction fn)
+{
+    if (routeCount_ < 16)
+        routes_[routeCount_++] = Route{uri, fn, nullptr};
+}
+
+void WebServer::on(const char *uri, HTTPMethod, THandlerFunction fn, THandlerFunction ufn)
+{
+    if (routeCount_ < 16)
+        routes_[routeCount_++] = Route{uri, fn, ufn};
+}
+
+String WebServer::arg(const char *name) const
+{
+    std::string key = std::string(name) + "=";
+    size_t pos = 0;
+    while (pos < query_.size())
+    {
+        size_t end = query_.find('&', pos);
+        if (end == std::string::npos)
+            end = query_.size();
+        if (query_.compare(pos, key.size(), key) == 0)
+            return String(query_.substr(pos + key.size(), end - pos - key.size()));
+        pos = end + 1;
+    }
+    return String();
+}
+
+bool WebServer::hasArg(const char *name) const
+{
+    std::string key = std::string(name) + "=";
+    return query_.compare(0, key.size(), key) == 0 || query_.find("&" + key) != std::string::npos;
+}
+
+void WebServer::send(int code, const char *, const String &content)
+{
+    lastCode_ = code;
+    body_.assign(content.c_str(), content.length());
+}
+
+void WebServer::send_P(int code, PGM_P, PGM_P content, size_t contentLength)
+{
+    lastCode_ = code;
+    body_.assign(content, contentLength);
+}
+
+void WebServer::sendContent(const char *content, size_t len)
+{
+    body_.append(content, len);
+}
+
+bool WebServer::fakeUpload(const char *uri, const char *query, const uint8_t *data, size_t len,
+                           int *code, std::string *body, std::function<void()> between)
+{
+    for (int i = 0; i < routeCount_; ++i)
+    {
+        if (routes_[i].uri != uri || !routes_[i].ufn)
+            continue;
+        query_ = query ? query : "";
+        lastCode_ = 0;
+        body_.clear();
+        upload_.filename = "firmware.bin";
+        upload_.name = "image";
+        upload_.type = "application/octet-stream";
+        upload_.totalSize = 0;
+        upload_.currentSize = 0;
+        upload_.status = UPLOAD_FILE_START;
+        routes_[i].ufn();
+        for (size_t off = 0; off < len; off += HTTP_UPLOAD_BUFLEN)
+        {
+            size_t n = len - off < HTTP_UPLOAD_BUFLEN ? len - off : HTTP_UPLOAD_BUFLEN;
+            memcpy(upload_.buf, data + off, n);
+            upload_.currentSize = n;
+            upload_.status = UPLOAD_FILE_WRITE;
+            routes_[i].ufn();
+            upload_.totalSize += n;
+            if (between)
+                between();
+        }
+        upload_.currentSize = 0;
+        upload_.status = UPLOAD_FILE_END;
+        routes_[i].ufn();
+        routes_[i].fn();
+        query_.clear();
+        if (code)
+            *code = lastCode_;
+        if (body)
+            *body = body_;
+        return true;
+    }
+    return false;
+}
+
+bool WebServer::fakeRequest(const char *uri, int *code, std::string *body)
+{
+    for (int i = 0; i < routeCount_; ++i)
+    {
+        if (routes_[i].uri == uri)
+        {
+            lastCode_ = 0;
+            body_.clear();
+            routes_[i].fn();
+            if (code)
+                *code = lastCode_;
+            if (body)
+                *body = body_;
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,14 @@
+#pragma once
+// 主机构建的 FreeRTOS 替身：主机上不创建后台任务
+#include <stdint.h>
+
+typedef void *TaskHandle_t;
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define pdPASS 1
+#define pdTRUE 1
+#define pdFALSE 0
+#define portMAX_DELAY 0xffffffffu
+#define tskIDLE_PRIORITY 0
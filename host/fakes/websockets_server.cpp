@@ -0,0 +1,444 @@
+// WebSocketsServer 替身实现：进程内模式与真实套接字模式
+#include <WebSocketsServer.h>
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static bool useSockets = false;
+static uint16_t portOverride = 0;
+
+// ---- 握手所需的 SHA-1 与 Base64 ----
+namespace
+{
+    uint32_t rol(uint32_t v, int n) { return (v << n) | (v >> (32 - n)); }
+
+    void sha1(const uint8_t *data, size_t len, uint8_t out[20])
+    {
+        uint32_t h[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+        std::string msg((const char *)data, len);
+        uint64_t bits = (uint64_t)len * 8;
+        msg += (char)0x80;
+        while (msg.size() % 64 != 56)
+            msg += (char)0;
+        for (int i = 7; i >= 0; --i)
+            msg += (char)(bits >> (i * 8));
+        for (size_t off = 0; off < msg.size(); off += 64)
+        {
+            uint32_t w[80];
+            for (int i = 0; i < 16; ++i)
+            {
+                const uint8_t *p = (const uint8_t *)msg.data() + off + i * 4;
+                w[i] = (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+            }
+            for (int i = 16; i < 80; ++i)
+                w[i] = rol(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+            uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+            for (int i = 0; i < 80; ++i)
+            {
+                uint32_t f, k;
+                if (i < 20)
+                    f = (b & c) | (~b & d), k = 0x5A827999;
+                else if (i < 40)
+                    f = b ^ c ^ d, k = 0x6ED9EBA1;
+                else if (i < 60)
+                    f = (b & c) | (b & d) | (c & d), k = 0x8F1BBCDC;
+                else
+                    f = b ^ c ^ d, k = 0xCA62C1D6;
+                uint32_t t = rol(a, 5) + f + e + k + w[i];
+                e = d;
+                d = c;
+                c = rol(b, 30);
+                b = a;
+                a = t;
+            }
+            h[0] += a;
+            h[1] += b;
+            h[2] += c;
+            h[3] += d;
+            h[4] += e;
+        }
+        for (int i = 0; i < 5; ++i)
+            for (int j = 0; j < 4; ++j)
+                out[i * 4 + j] = (uint8_t)(h[i] >> (24 - j * 8));
+    }
+
+    std::string base64(const uint8_t *data, size_t len)
+    {
+        static const char tbl[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        std::string out;
+        for (size_t i = 0; i < len; i += 3)
+        {
+            uint32_t v = (uint32_t)data[i] << 16;
+            if (i + 1 < len)
+                v |= (uint32_t)data[i + 1] << 8;
+            if (i + 2 < len)
+                v |= data[i + 2];
+            out += tbl[(v >> 18) & 63];
+            out += tbl[(v >> 12) & 63];
+            out += i + 1 < len ? tbl[(v >> 6) & 63] : '=';
+            out += i + 2 < len ? tbl[v & 63] : '=';
+        }
+        return out;
+    }
+
+    // 阻塞写完整个缓冲（套接字为非阻塞，满时等待可写）
+    bool writeAll(int fd, const uint8_t *data, size_t len)
+    {
+        while (len > 0)
+        {
+            ssize_t n = ::send(fd, data, len, MSG_NOSIGNAL);
+            if (n > 0)
+            {
+                data += n;
+                len -= (size_t)n;
+                continue;
+            }
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            {
+                pollfd p{fd, POLLOUT, 0};
+                if (::poll(&p, 1, 1000) <= 0)
+                    return false;
+                continue;
+            }
+            return false;
+        }
+        return true;
+    }
+}
+
+void WebSocketsServer::fakeEnableSockets(uint16_t port)
+{
+    useSockets = true;
+    portOverride = port;
+}
+
+void WebSocketsServer::begin()
+{
+    if (!useSockets)
+        return;
+    uint16_t port = portOverride ? portOverride : port_;
+    listenFd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+    if (::bind(listenFd_, (sockaddr *)&addr, sizeof(addr)) != 0 || ::listen(listenFd_, 16) != 0)
+    {
+        Serial.printf("WebSocketsServer: cannot listen on port %u: %s\n", port, strerror(errno));
+        ::close(listenFd_);
+        listenFd_ = -1;
+        return;
+    }
+    fcntl(listenFd_, F_SETFL, O_NONBLOCK);
+    Serial.printf("WebSocketsServer: listening on port %u\n", port);
+}
+
+void WebSocketsServer::loop()
+{
+    if (listenFd_ < 0)
+        return;
+    acceptClients();
+    for (uint8_t i = 0; i < WEBSOCKETS_SERVER_CLIENT_MAX; ++i)
+    {
+        if (fds_[i] >= 0)
+            pollClient(i);
+    }
+}
+
+void WebSocketsServer::acceptClients()
+{
+    for (;;)
+    {
+        int fd = ::accept(listenFd_, nullptr, nullptr);
+        if (fd < 0)
+            return;
+        int slot = -1;
+        for (int i = 0; i < WEBSOCKETS_SERVER_CLIENT_MAX; ++i)
+        {
+            if (fds_[i] < 0)
+            {
+                slot = i;
+                break;
+            }
+        }
+        // 与真实库一致：客户端槽位已满时直接拒绝
+        if (slot < 0)
+        {
+            ::close(fd);
+            continue;
+        }
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        fcntl(fd, F_SETFL, O_NONBLOCK);
+        fds_[slot] = fd;
+        handshaken_[slot] = false;
+        inbuf_[slot].clear();
+    }
+}
+
+void WebSocketsServer::pollClient(uint8_t num)
+{
+    int fd = fds_[num];
+    uint8_t buf[4096];
+    for (;;)
+    {
+        ssize_t n = ::recv(fd, buf, sizeof(buf), 0);
+        if (n > 0)
+        {
+            inbuf_[num].append((const char *)buf, (size_t)n);
+            continue;
+        }
+        if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK))
+        {
+            closeClient(num);
+            return;
+        }
+        break;
+    }
+
+    std::string &in = inbuf_[num];
+    if (!handshaken_[num])
+    {
+        size_t end = in.find("\r\n\r\n");
+        if (end == std::string::npos)
+            return;
+        const char *hdr = "Sec-WebSocket-Key:";
+        size_t k = in.find(hdr);
+        if (k == std::string::npos || k > end)
+        {
+            closeClient(num);
+            return;
+        }
+        k += strlen(hdr);
+        while (in[k] == ' ')
+            ++k;
+        std::string key = in.substr(k, in.find("\r\n", k) - k);
+        key += "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+        uint8_t digest[20];
+        sha1((const uint8_t *)key.data(), key.size(), digest);
+        // 请求行 "GET <path> HTTP/1.1" 中的路径
+        std::string path;
+        size_t sp = in.find(' ');
+        if (sp != std::string::npos && sp < end)
+            path = in.substr(sp + 1, in.find(' ', sp + 1) - sp - 1);
+        std::string resp = "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Accept: " + base64(digest, 20) + "\r\n\r\n";
+        in.erase(0, end + 4);
+        if (!writeAll(fd, (const uint8_t *)resp.data(), resp.size()))
+        {
+            closeClient(num);
+            return;
+        }
+        handshaken_[num] = true;
+        connected_[num] = true;
+        if (cb_)
+            cb_(num, WStype_CONNECTED, (uint8_t *)&path[0], path.size());
+    }
+
+    // 解析完整的帧；客户端到服务器的帧必须带掩码
+    while (fds_[num] >= 0 && in.size() >= 2)
+    {
+        const uint8_t *p = (const uint8_t *)in.data();
+        uint8_t opcode = p[0] & 0x0F;
+        bool masked = p[1] & 0x80;
+        uint64_t len = p[1] & 0x7F;
+        size_t pos = 2;
+        if (len == 126)
+        {
+            if (in.size() < 4)
+                return;
+            len = (uint64_t)p[2] << 8 | p[3];
+            pos = 4;
+        }
+        else if (len == 127)
+        {
+            if (in.size() < 10)
+                return;
+            len = 0;
+            for (int i = 0; i < 8; ++i)
+                len = len << 8 | p[2 + i];
+            pos = 10;
+        }
+        size_t maskPos = pos;
+        if (masked)
+            pos += 4;
+        if (in.size() < pos + len)
+            return;
+        std::string payload = in.substr(pos, (size_t)len);
+        if (masked)
+        {
+            for (size_t i = 0; i < payload.size(); ++i)
+                payload[i] ^= p[maskPos + (i & 3)];
+        }
+        in.erase(0, pos + (size_t)len);
+
+        switch (opcode)
+        {
+        case 0x1:
+            if (cb_)
+                cb_(num, WStype_TEXT, (uint8_t *)&payload[0], payload.size());
+            break;
+        case 0x2:
+            if (cb_)
+                cb_(num, WStype_BIN, (uint8_t *)&payload[0], payload.size());
+            break;
+        case 0x8:
+            writeFrame(num, 0x8, nullptr, 0);
+            closeClient(num);
+            return;
+        case 0x9:
+            writeFrame(num, 0xA, (const uint8_t *)payload.data(), payload.size());
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+void WebSocketsServer::closeClient(uint8_t num)
+{
+    if (fds_[num] >= 0)
+        ::close(fds_[num]);
+    fds_[num] = -1;
+    handshaken_[num] = false;
+    inbuf_[num].clear();
+    if (connected_[num])
+    {
+        connected_[num] = false;
+        if (cb_)
+            cb_(num, WStype_DISCONNECTED, nullptr, 0);
+    }
+}
+
+bool WebSocketsServer::writeFrame(uint8_t num, uint8_t opcode, const uint8_t *payload, size_t length)
+{
+    if (fds_[num] < 0)
+        return true;
+    uint8_t hdr[10];
+    size_t h = 0;
+    hdr[h++] = 0x80 | opcode;
+    if (length < 126)
+    {
+        hdr[h++] = (uint8_t)length;
+    }
+    else if (length < 65536)
+    {
+        hdr[h++] = 126;
+        hdr[h++] = (uint8_t)(length >> 8);
+        hdr[h++] = (uint8_t)length;
+    }
+    else
+    {
+        hdr[h++] = 127;
+        for (int i = 7; i >= 0; --i)
+            hdr[h++] = (uint8_t)((uint64_t)length >> (i * 8));
+    }
+    int fd = fds_[num];
+    if (!writeAll(fd, hdr, h) || (length && !writeAll(fd, payload, length)))
+    {
+        closeClient(num);
+        return false;
+    }
+    return true;
+}
+
+// ---- 发送接口：两种模式共用计数，套接字模式额外写出帧 ----
+bool WebSocketsServer::sendTXT(uint8_t num, const uint8_t *payload, size_t length)
+{
+    if (num >= WEBSOCKETS_SERVER_CLIENT_MAX || !connected_[num])
+        return false;
+    if (length == 0)
+        length = strlen((const char *)payload);
+    sent_++;
+    sentBytes_ += length;
+    last_.assign((const char *)payload, length);
+    if (sink_)
+        sink_(num, payload, length, false);
+    return writeFrame(num, 0x1, payload, length);
+}
+
+bool WebSocketsServer::broadcastTXT(const uint8_t *payload, size_t length)
+{
+    bool ok = true;
+    for (uint8_t i = 0; i < WEBSOCKETS_SERVER_CLIENT_MAX; ++i)
+    {
+        if (connected_[i])
+            ok = sendTXT(i, payload, length) && ok;
+    }
+    return ok;
+}
+
+bool WebSocketsServer::sendBIN(uint8_t num, const uint8_t *payload, size_t length)
+{
+    if (num >= WEBSOCKETS_SERVER_CLIENT_MAX || !connected_[num])
+        return false;
+    sent_++;
+    sentBytes_ += length;
+    if (sink_)
+        sink_(num, payload, length, true);
+    return writeFrame(num, 0x2, payload, length);
+}
+
+uint8_t WebSocketsServer::connectedClients(bool)
+{
+    uint8_t n = 0;
+    for (bool c : connected_)
+        n += c ? 1 : 0;
+    return n;
+}
+
+bool WebSocketsServer::clientIsConnected(uint8_t num)
+{
+    return num < WEBSOCKETS_SERVER_CLIENT_MAX && connected_[num];
+}
+
+void WebSocketsServer::disconnect(uint8_t num)
+{
+    if (num >= WEBSOCKETS_SERVER_CLIENT_MAX)
+        return;
+    if (fds_[num] >= 0)
+        closeClient(num);
+    else
+        fakeDisconnect(num);
+}
+
+void WebSocketsServer::fakeConnect(uint8_t num, const char *url)
+{
+    if (num >= WEBSOCKETS_SERVER_CLIENT_MAX || connected_[num])
+        return;
+    connected_[num] = true;
+    if (cb_)
+        cb_(num, WStype_CONNECTED, (uint8_t *)url, url ? strlen(url) : 0);
+}
+
+void WebSocketsServer::fakeDisconnect(uint8_t num)
+{
+    if (num >= WEBSOCKETS_SERVER_CLIENT_MAX || !connected_[num])
+        return;
+    connected_[num] = false;
+    if (cb_)
+        cb_(num, WStype_DISCONNECTED, nullptr, 0);
+}
+
+// 与真实库一致，回调拿到的是可写的副本（ArduinoJson 会就地解析）
+void WebSocketsServer::fakeText(uint8_t num, const char *text)
+{
+    if (!cb_)
+        return;
+    std::string copy(text);
+    cb_(num, WStype_TEXT, (uint8_t *)&copy[0], copy.size());
+}
+
+void WebSocketsServer::fakeBinary(uint8_t num, const uint8_t *data, size_t len)
+{
+    if (!cb_)
+        return;
+    std::string copy((const char *)data, len);
+    cb_(num, WStype_BIN, (uint8_t *)&copy[0], len);
+}
@@ -0,0 +1,133 @@
+// WiFiUDP 替身实现（POSIX 套接字）
+#include <WiFiUdp.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static in_addr_t toInAddr(IPAddress ip)
+{
+    // IPAddress 按网络字节序保存 4 个字节，转换为 uint32_t 后即为 in_addr_t
+    return (in_addr_t)(uint32_t)ip;
+}
+
+uint8_t WiFiUDP::begin(uint16_t port)
+{
+    stop();
+    fd_ = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd_ < 0)
+        return 0;
+    int one = 1;
+    setsockopt(fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    setsockopt(fd_, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one));
+    fcntl(fd_, F_SETFL, fcntl(fd_, F_GETFL) | O_NONBLOCK);
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (bind(fd_, (sockaddr *)&addr, sizeof(addr)) < 0)
+    {
+        stop();
+        return 0;
+    }
+    port_ = port;
+    // 组播只走回环接口，并回送给本机的其他实例
+    in_addr lo;
+    lo.s_addr = htonl(INADDR_LOOPBACK);
+    setsockopt(fd_, IPPROTO_IP, IP_MULTICAST_IF, &lo, sizeof(lo));
+    setsockopt(fd_, IPPROTO_IP, IP_MULTICAST_LOOP, &one, sizeof(one));
+    return 1;
+}
+
+uint8_t WiFiUDP::beginMulticast(IPAddress address, uint16_t port)
+{
+    if (!begin(port))
+        return 0;
+    ip_mreq mreq = {};
+    mreq.imr_multiaddr.s_addr = toInAddr(address);
+    mreq.imr_interface.s_addr = htonl(INADDR_LOOPBACK);
+    if (setsockopt(fd_, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0)
+    {
+        stop();
+        return 0;
+    }
+    multicastAddr_ = toInAddr(address);
+    return 1;
+}
+
+void WiFiUDP::stop()
+{
+    if (fd_ >= 0)
+        close(fd_);
+    fd_ = -1;
+    multicastAddr_ = 0;
+    rxLen_ = rxPos_ = 0;
+}
+
+int WiFiUDP::beginPacket(IPAddress ip, uint16_t port)
+{
+    txAddr_ = toInAddr(ip);
+    txPort_ = port;
+    txLen_ = 0;
+    return fd_ >= 0;
+}
+
+int WiFiUDP::beginMulticastPacket()
+{
+    if (!multicastAddr_)
+        return 0;
+    txAddr_ = multicastAddr_;
+    txPort_ = port_;
+    txLen_ = 0;
+    return fd_ >= 0;
+}
+
+size_t WiFiUDP::write(const uint8_t *buf, size_t len)
+{
+    size_t n = std::min(len, sizeof(tx_) - txLen_);
+    memcpy(tx_ + txLen_, buf, n);
+    txLen_ += n;
+    return n;
+}
+
+int WiFiUDP::endPacket()
+{
+    if (fd_ < 0)
+        return 0;
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(txPort_);
+    addr.sin_addr.s_addr = txAddr_;
+    ssize_t n = sendto(fd_, tx_, txLen_, 0, (sockaddr *)&addr, sizeof(addr));
+    txLen_ = 0;
+    return n >= 0;
+}
+
+int WiFiUDP::parsePacket()
+{
+    if (fd_ < 0)
+        return 0;
+    sockaddr_in from = {};
+    socklen_t fromLen = sizeof(from);
+    ssize_t n = recvfrom(fd_, rx_, sizeof(rx_), 0, (sockaddr *)&from, &fromLen);
+    if (n <= 0)
+    {
+        rxLen_ = rxPos_ = 0;
+        return 0;
+    }
+    rxLen_ = (size_t)n;
+    rxPos_ = 0;
+    uint32_t a = from.sin_addr.s_addr;
+    remoteIP_ = IPAddress(a & 0xFF, (a >> 8) & 0xFF, (a >> 16) & 0xFF, (a >> 24) & 0xFF);
+    remotePort_ = ntohs(from.sin_port);
+    return (int)n;
+}
+
+int WiFiUDP::read(uint8_t *buf, size_t len)
+{
+    size_t n = std::min(len, rxLen_ - rxPos_);
+    memcpy(buf, rx_ + rxPos_, n);
+    rxPos_ += n;
+    return (int)n;
+}
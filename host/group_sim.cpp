@@ -0,0 +1,94 @@
+// 群控模拟：在同一台 Linux 主机上 fork 多个固件实例，各自注入不同的时钟偏移，
+// 通过回环接口上的 UDP 组播组成一个组（实例 0 为 leader），结束时输出每个 member 的同步误差
+#include <Arduino.h>
+#include <WebSocketsServer.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "host_tools.h"
+#include "group_sync.h"
+#include "led_controller.h"
+#include "network.h"
+
+void setup();
+void loop();
+
+// 实例 i 的本地时钟 = 公共时钟 + offsetFor(i)；取互不相同且不成整数倍的偏移，避免相位巧合对齐
+static int64_t offsetFor(int i)
+{
+    return (int64_t)i * 7777777 + (i % 2) * 123457;
+}
+
+static int runNode(int index, int group, uint32_t durationMs, const char *command)
+{
+    FakeClock::setOffsetMicros(offsetFor(index));
+    Serial.muted = true;
+    setup();
+    WebSocketsServer *ws = Network::getWebSocketServer();
+    ws->fakeConnect(0);
+    char join[64];
+    snprintf(join, sizeof(join), "{\"cmd\":\"group\",\"action\":\"%s\",\"id\":%d}",
+             index == 0 ? "lead" : "join", group);
+    ws->fakeText(0, join);
+    if (index == 0)
+        ws->fakeText(0, command);
+
+    unsigned long start = millis();
+    while (millis() - start < durationMs)
+        loop();
+
+    int64_t est = GroupSync::getOffsetUs();
+    int64_t truth = index == 0 ? 0 : offsetFor(0) - offsetFor(index);
+    printf("{\"node\":%d,\"role\":\"%s\",\"synced\":%s,\"mode\":\"%s\",\"brightness\":%u,"
+           "\"offset_est_us\":%lld,\"offset_true_us\":%lld,\"sync_err_us\":%lld,\"jitter_us\":%u}\n",
+           index, GroupSync::getRoleStr(), GroupSync::isSynced() ? "true" : "false",
+           LedController::getModeStr(), LedController::getBrightness(),
+           (long long)est, (long long)truth, (long long)(est - truth), GroupSync::getJitterUs());
+    fflush(stdout);
+    // 以 0 退出码表示已同步，父进程据此汇总
+    return GroupSync::isSynced() ? 0 : 1;
+}
+
+int runGroupSim(int argc, char **argv)
+{
+    int nodes = 3;
+    int group = 1;
+    uint32_t durationMs = 5000;
+    const char *command = "{\"cmd\":\"set_mode\",\"mode\":\"blink\",\"hz\":2}";
+    for (int i = 0; i + 1 < argc; ++i)
+    {
+        if (strcmp(argv[i], "--nodes") == 0)
+            nodes = max(2, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--group") == 0)
+            group = atoi(argv[++i]) & 0xFF;
+        else if (strcmp(argv[i], "--ms") == 0)
+            durationMs = (uint32_t)atoi(argv[++i]);
+        else if (strcmp(argv[i], "--cmd") == 0)
+            command = argv[++i];
+    }
+
+    // 每个实例使用各自的临时 SPIFFS 目录，互不影响持久化的群控角色
+    unsetenv("STUPID_LED_FS");
+    fflush(stdout);
+    for (int i = 0; i < nodes; ++i)
+    {
+        pid_t pid = fork();
+        if (pid < 0)
+        {
+            perror("fork");
+            return 1;
+        }
+        // 子进程用 exit 退出，以便删除各自的临时 SPIFFS 目录（stdout 已在 fork 前刷新）
+        if (pid == 0)
+            exit(runNode(i, group, durationMs, command));
+    }
+
+    int failed = 0;
+    for (int i = 0; i < nodes; ++i)
+    {
+        int status = 0;
+        wait(&status);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+            failed++;
+    }
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,91 @@
+// 主机（native）构建入口：在 Linux 上运行固件逻辑，用于测试、计时与回放
+#include <Arduino.h>
+#include <WebSocketsServer.h>
+#include "host_tools.h"
+#include <signal.h>
+
+// 固件入口（src/main.cpp）
+void setup();
+void loop();
+
+// SIGINT / SIGTERM 时退出主循环并正常返回，使 atexit 注册的临时文件清理得以执行
+static volatile sig_atomic_t stopRequested = 0;
+
+static void onStopSignal(int)
+{
+    stopRequested = 1;
+}
+
+static int runLoop()
+{
+    signal(SIGINT, onStopSignal);
+    signal(SIGTERM, onStopSignal);
+    setup();
+    while (!stopRequested)
+        loop();
+    return 0;
+}
+
+// 以真实 TCP 套接字对外提供 WebSocket 服务（端口 81 需要特权，默认改用 8181）
+static int runServe(int argc, char **argv)
+{
+    uint16_t port = 8181;
+    for (int i = 0; i + 1 < argc; ++i)
+    {
+        if (strcmp(argv[i], "--port") == 0)
+            port = (uint16_t)atoi(argv[++i]);
+    }
+    WebSocketsServer::fakeEnableSockets(port);
+    return runLoop();
+}
+
+static int usage()
+{
+    fprintf(stderr,
+            "usage: program <command> [options]\n"
+            "  bench [--iterations N] [--filter SUBSTR]   run hot-path microbenchmarks, JSON to stdout\n"
+            "  run                                       run setup()/loop() forever\n"
+            "  serve [--port P]                          run the firmware with a real WebSocket listener (default 8181)\n"
+            "  load [--host H] [--port P] [--clients N] [--rate CMD_PER_S] [--duration S] [--report S]\n"
+            "       [--mix set_mode=1,set_brightness=3,get_status=1]\n"
+            "                                            WebSocket load generator, JSON lines to stdout\n"
+            "  replay <trace.bin> [--repeat N]           replay a captured trace, per-event cost as JSON lines\n"
+            "  trace-synth <out.bin> [--scenario slider|reconnect|stream]\n"
+            "                                            write a synthetic trace\n"
+            "  waveform [--cmd JSON] [--ms N] [--step-us N]\n"
+            "                                            apply a command and dump the recorded LED waveform\n"
+            "  group-sim [--nodes N] [--group ID] [--ms N] [--cmd JSON]\n"
+            "                                            fork N instances synced over loopback multicast, report sync error\n"
+            "  ota-sim [--image FILE | --size N] [--chunk N] [--via ws|http] [--corrupt]\n"
+            "                                            stream an image through the OTA pipeline into a file-backed partition\n"
+            "  logdecode FILE                            render a /log download as text\n");
+    return 2;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+        return usage();
+    const char *cmd = argv[1];
+    if (strcmp(cmd, "bench") == 0)
+        return runBench(argc - 2, argv + 2);
+    if (strcmp(cmd, "serve") == 0)
+        return runServe(argc - 2, argv + 2);
+    if (strcmp(cmd, "load") == 0)
+        return runLoad(argc - 2, argv + 2);
+    if (strcmp(cmd, "replay") == 0)
+        return runReplay(argc - 2, argv + 2);
+    if (strcmp(cmd, "trace-synth") == 0)
+        return runTraceSynth(argc - 2, argv + 2);
+    if (strcmp(cmd, "waveform") == 0)
+        return runWaveform(argc - 2, argv + 2);
+    if (strcmp(cmd, "group-sim") == 0)
+        return runGroupSim(argc - 2, argv + 2);
+    if (strcmp(cmd, "ota-sim") == 0)
+        return runOtaSim(argc - 2, argv + 2);
+    if (strcmp(cmd, "logdecode") == 0)
+        return runLogDecode(argc - 2, argv + 2);
+    if (strcmp(cmd, "run") == 0)
+        return runLoop();
+    return usage();
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+// 主机（native）构建的子命令入口，均返回进程退出码
+int runBench(int argc, char **argv);
+// WebSocket 负载生成器（客户端侧），连接 serve 或真实设备
+int runLoad(int argc, char **argv);
+// 回放 WebSocket 流量录制并逐事件计时；trace-synth 生成合成录制
+int runReplay(int argc, char **argv);
+int runTraceSynth(int argc, char **argv);
+// 在虚拟时钟上导出 LED 波形（Recorder 输出后端）
+int runWaveform(int argc, char **argv);
+// 多实例群控模拟：回环组播，输出每个 member 的时钟偏移估计误差
+int runGroupSim(int argc, char **argv);
+// OTA 块管线：镜像经 WebSocket 或 HTTP 上传写入文件模拟的分区，校验后切换启动分区
+int runOtaSim(int argc, char **argv);
+// 二进制日志（/log 下载）解码为文本
+int runLogDecode(int argc, char **argv);
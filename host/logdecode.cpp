@@ -0,0 +1,56 @@
+// 二进制日志解码：把 /log 下载的文件按固件的格式表还原为文本
+#include <Arduino.h>
+#include <vector>
+#include "host_tools.h"
+#include "log.h"
+
+int runLogDecode(int argc, char **argv)
+{
+    if (argc < 1)
+    {
+        fprintf(stderr, "usage: logdecode FILE\n");
+        return 2;
+    }
+    FILE *f = fopen(argv[0], "rb");
+    if (!f)
+    {
+        fprintf(stderr, "cannot open %s\n", argv[0]);
+        return 2;
+    }
+    Log::FileHeader h;
+    if (fread(&h, sizeof(h), 1, f) != 1 || h.magic != Log::FILE_MAGIC)
+    {
+        fprintf(stderr, "not a log file\n");
+        fclose(f);
+        return 1;
+    }
+    if (h.version != Log::FILE_VERSION || h.recordSize != sizeof(Log::Record))
+    {
+        fprintf(stderr, "unsupported log version %u (record size %u)\n", h.version, h.recordSize);
+        fclose(f);
+        return 1;
+    }
+    // 格式表不一致时仍尝试解码，但 id 可能对应到错误的格式串
+    if (h.formatHash != Log::formatHash())
+        fprintf(stderr, "warning: format table mismatch (file %08x, decoder %08x)\n", h.formatHash, Log::formatHash());
+    if (h.evicted)
+        printf("# %u older record(s) were overwritten\n", h.evicted);
+
+    Log::Record r;
+    char line[256];
+    uint32_t n = 0;
+    while (n < h.count && fread(&r, sizeof(r), 1, f) == 1)
+    {
+        Log::format(r, line, sizeof(line));
+        const char *level = r.id < Log::ID_COUNT ? Log::getLevelStr(Log::FORMATS[r.id].level) : "?";
+        printf("%-5s %s\n", level, line);
+        n++;
+    }
+    fclose(f);
+    if (n != h.count)
+    {
+        fprintf(stderr, "truncated: %u of %u records\n", n, h.count);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,172 @@
+// OTA 模拟：把镜像按块经 WebSocket 二进制帧或 HTTP 分段上传送入固件，写入文件模拟的 OTA 分区，
+// 检查分区内容、启动分区切换与重启请求，并统计块处理吞吐量与上传期间的 LED 输出变化
+#include <Arduino.h>
+#include <WebServer.h>
+#include <WebSocketsServer.h>
+#include <esp_ota_ops.h>
+#include <mbedtls/sha256.h>
+#include <chrono>
+#include <vector>
+#include "host_tools.h"
+#include "led_controller.h"
+#include "led_output.h"
+#include "network.h"
+#include "ota_update.h"
+
+void setup();
+void loop();
+
+static std::vector<uint8_t> makeImage(size_t size)
+{
+    // 以镜像头魔数 0xE9 开头，其余为伪随机内容
+    std::vector<uint8_t> img(size);
+    uint32_t x = 0x12345678;
+    for (size_t i = 0; i < size; ++i)
+    {
+        x = x * 1664525u + 1013904223u;
+        img[i] = (uint8_t)(x >> 24);
+    }
+    if (size)
+        img[0] = 0xE9;
+    return img;
+}
+
+static bool loadImage(const char *path, std::vector<uint8_t> &img)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f)
+        return false;
+    uint8_t buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+        img.insert(img.end(), buf, buf + n);
+    fclose(f);
+    return true;
+}
+
+static std::string sha256Hex(const std::vector<uint8_t> &img)
+{
+    mbedtls_sha256_context ctx;
+    uint8_t digest[32];
+    mbedtls_sha256_init(&ctx);
+    mbedtls_sha256_starts_ret(&ctx, 0);
+    mbedtls_sha256_update_ret(&ctx, img.data(), img.size());
+    mbedtls_sha256_finish_ret(&ctx, digest);
+    mbedtls_sha256_free(&ctx);
+    char hex[65];
+    for (int i = 0; i < 32; ++i)
+        snprintf(hex + i * 2, 3, "%02x", digest[i]);
+    return hex;
+}
+
+int runOtaSim(int argc, char **argv)
+{
+    const char *imagePath = nullptr;
+    size_t size = 1024 * 1024;
+    size_t chunk = 4096;
+    bool viaHttp = false;
+    bool corrupt = false;
+    for (int i = 0; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--image") == 0 && i + 1 < argc)
+            imagePath = argv[++i];
+        else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc)
+            size = (size_t)atol(argv[++i]);
+        else if (strcmp(argv[i], "--chunk") == 0 && i + 1 < argc)
+            chunk = max(1, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--via") == 0 && i + 1 < argc)
+            viaHttp = strcmp(argv[++i], "http") == 0;
+        else if (strcmp(argv[i], "--corrupt") == 0)
+            corrupt = true;
+    }
+
+    std::vector<uint8_t> img;
+    if (imagePath)
+    {
+        if (!loadImage(imagePath, img))
+        {
+            fprintf(stderr, "cannot read %s\n", imagePath);
+            return 2;
+        }
+    }
+    else
+    {
+        img = makeImage(size);
+    }
+    std::string hex = sha256Hex(img);
+    // 哈希按原始镜像计算，传输时翻转中间一个字节，应在切换启动分区前被拒绝
+    if (corrupt && !img.empty())
+        img[img.size() / 2] ^= 0x01;
+
+    Serial.muted = true;
+    setup();
+    WebSocketsServer *ws = Network::getWebSocketServer();
+    ws->fakeConnect(0);
+    // 上传期间保持闪烁，用于确认动画没有被阻塞
+    ws->fakeText(0, "{\"cmd\":\"set_mode\",\"mode\":\"blink\",\"hz\":10}");
+    LedOutput::Recorder::clear();
+    const esp_partition_t *bootBefore = esp_ota_get_boot_partition();
+
+    uint64_t pipelineNs = 0;
+    uint32_t chunks = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    if (viaHttp)
+    {
+        char query[128];
+        snprintf(query, sizeof(query), "size=%zu&sha256=%s", img.size(), hex.c_str());
+        int code = 0;
+        std::string body;
+        Network::getHttpServer()->fakeUpload("/ota", query, img.data(), img.size(), &code, &body, [&]()
+                                             { chunks++; });
+        pipelineNs = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count();
+    }
+    else
+    {
+        char begin[160];
+        snprintf(begin, sizeof(begin), "{\"cmd\":\"ota_begin\",\"size\":%zu,\"sha256\":\"%s\"}", img.size(), hex.c_str());
+        ws->fakeText(0, begin);
+        std::vector<uint8_t> frame(5 + chunk);
+        for (size_t off = 0; off < img.size(); off += chunk)
+        {
+            size_t n = min(chunk, img.size() - off);
+            frame[0] = 0x02;
+            frame[1] = (uint8_t)off;
+            frame[2] = (uint8_t)(off >> 8);
+            frame[3] = (uint8_t)(off >> 16);
+            frame[4] = (uint8_t)(off >> 24);
+            memcpy(frame.data() + 5, img.data() + off, n);
+            auto c0 = std::chrono::steady_clock::now();
+            ws->fakeBinary(0, frame.data(), 5 + n);
+            pipelineNs += (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - c0).count();
+            chunks++;
+            // 设备上每帧之间会跑一轮 loop
+            loop();
+        }
+    }
+    double uploadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    size_t ledChanges = LedOutput::Recorder::size();
+
+    // 继续运行 loop，等待延迟重启
+    unsigned long waitStart = millis();
+    while (ESP.fakeRestarts == 0 && millis() - waitStart < 2000)
+        loop();
+
+    // 比对分区文件与镜像
+    bool contentOk = false;
+    std::vector<uint8_t> written;
+    if (loadImage(fakeOtaPartitionPath(), written))
+        contentOk = written == img;
+    bool switched = esp_ota_get_boot_partition() != bootBefore;
+
+    printf("{\"via\":\"%s\",\"bytes\":%zu,\"chunks\":%u,\"state\":\"%s\",\"error\":\"%s\","
+           "\"pipeline_us\":%.1f,\"pipeline_mb_s\":%.1f,\"upload_ms\":%.1f,"
+           "\"led_changes_during_upload\":%zu,\"partition_matches\":%s,\"boot_switched\":%s,\"restarts\":%u}\n",
+           viaHttp ? "http" : "ws", img.size(), chunks, OtaUpdate::getStateStr(), OtaUpdate::getError(),
+           pipelineNs / 1000.0, pipelineNs ? img.size() * 1000.0 / pipelineNs : 0.0, uploadMs,
+           ledChanges, contentOk ? "true" : "false", switched ? "true" : "false", ESP.fakeRestarts);
+
+    // 损坏的镜像必须被拒绝且不切换启动分区；正常镜像必须完整写入并切换
+    bool ok = corrupt ? (!switched && OtaUpdate::getState() == OtaUpdate::OTA_ERROR)
+                      : (switched && contentOk && OtaUpdate::getState() == OtaUpdate::OTA_DONE && ESP.fakeRestarts > 0);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,322 @@
+// WebSocket 流量回放：把录制文件（ws_trace.h 格式）按虚拟时钟喂给 handleWSMessage，
+// 逐事件输出处理耗时；同一录制在两个版本上的输出差异即为性能回归
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <WebSocketsServer.h>
+#include <chrono>
+#include <map>
+#include <vector>
+#include "host_tools.h"
+#include "led_controller.h"
+#include "network.h"
+#include "ws_trace.h"
+
+void setup();
+void handleWSMessage(uint8_t num, WStype_t type, uint8_t *payload, size_t length);
+
+namespace
+{
+    struct Event
+    {
+        uint64_t tUs; // 由记录间隔累加得到的相对时间
+        uint8_t type;
+        uint8_t client;
+        std::string payload;
+        std::string kind; // connect / disconnect / bin / 文本命令名
+    };
+
+    const char *typeName(uint8_t type)
+    {
+        switch (type)
+        {
+        case WsTrace::EV_CONNECT:
+            return "connect";
+        case WsTrace::EV_DISCONNECT:
+            return "disconnect";
+        case WsTrace::EV_TEXT:
+            return "text";
+        case WsTrace::EV_BIN:
+            return "bin";
+        default:
+            return "unknown";
+        }
+    }
+
+    bool loadTrace(const char *path, std::vector<Event> &events, WsTrace::FileHeader &hdr)
+    {
+        FILE *f = fopen(path, "rb");
+        if (!f)
+        {
+            fprintf(stderr, "cannot open %s\n", path);
+            return false;
+        }
+        uint64_t tUs = 0;
+        bool ok = fread(&hdr, sizeof(hdr), 1, f) == 1 && hdr.magic == WsTrace::FILE_MAGIC && hdr.version == WsTrace::FILE_VERSION;
+        for (uint32_t i = 0; ok && i < hdr.count; ++i)
+        {
+            WsTrace::RecordHeader rh;
+            if (fread(&rh, sizeof(rh), 1, f) != 1)
+            {
+                ok = false;
+                break;
+            }
+            Event ev;
+            tUs += rh.dtUs;
+            ev.tUs = tUs;
+            ev.type = rh.type;
+            ev.client = rh.client;
+            ev.payload.resize(rh.len);
+            if (rh.len && fread(&ev.payload[0], 1, rh.len, f) != rh.len)
+            {
+                ok = false;
+                break;
+            }
+            ev.kind = typeName(ev.type);
+            if (ev.type == WsTrace::EV_TEXT)
+            {
+                StaticJsonDocument<256> doc;
+                if (deserializeJson(doc, ev.payload.data(), ev.payload.size()))
+                    ev.kind = "invalid_json";
+                else
+                    ev.kind = doc["cmd"] | "missing_cmd";
+            }
+            events.push_back(std::move(ev));
+        }
+        fclose(f);
+        if (!ok)
+            fprintf(stderr, "%s: not a valid trace file\n", path);
+        return ok;
+    }
+
+    double nowNs()
+    {
+        using namespace std::chrono;
+        return (double)duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+    }
+
+    // 回放一个事件并返回耗时（ns）；负载在调用前复制，因为解析会就地修改
+    double dispatch(WebSocketsServer *ws, const Event &ev, std::string &scratch)
+    {
+        scratch = ev.payload;
+        double t0 = nowNs();
+        switch (ev.type)
+        {
+        case WsTrace::EV_CONNECT:
+            ws->fakeConnect(ev.client);
+            break;
+        case WsTrace::EV_DISCONNECT:
+            ws->fakeDisconnect(ev.client);
+            break;
+        case WsTrace::EV_TEXT:
+            handleWSMessage(ev.client, WStype_TEXT, (uint8_t *)&scratch[0], scratch.size());
+            break;
+        case WsTrace::EV_BIN:
+            handleWSMessage(ev.client, WStype_BIN, (uint8_t *)&scratch[0], scratch.size());
+            break;
+        }
+        return nowNs() - t0;
+    }
+
+    // 合成录制的上一条记录时间：putRecord 接受绝对时间（须递增），写入时转为间隔
+    uint32_t synthLastUs = 0;
+
+    void putRecord(FILE *f, uint32_t tUs, uint8_t type, uint8_t client, const void *data, size_t len)
+    {
+        WsTrace::RecordHeader rh;
+        rh.dtUs = tUs - synthLastUs;
+        synthLastUs = tUs;
+        rh.type = type;
+        rh.client = client;
+        rh.len = (uint16_t)len;
+        fwrite(&rh, sizeof(rh), 1, f);
+        if (rh.len)
+            fwrite(data, 1, rh.len, f);
+    }
+
+    void putRecord(FILE *f, uint32_t tUs, uint8_t type, uint8_t client, const char *text)
+    {
+        putRecord(f, tUs, type, client, text, strlen(text));
+    }
+
+    // 不带数据的记录（连接 / 断开），只写记录头
+    void putEmpty(FILE *f, uint32_t tUs, uint8_t type, uint8_t client)
+    {
+        WsTrace::RecordHeader rh;
+        rh.dtUs = tUs - synthLastUs;
+        synthLastUs = tUs;
+        rh.type = type;
+        rh.client = client;
+        rh.len = 0;
+        fwrite(&rh, sizeof(rh), 1, f);
+    }
+}
+
+int runReplay(int argc, char **argv)
+{
+    if (argc < 1)
+    {
+        fprintf(stderr, "usage: replay <trace.bin> [--repeat N]\n");
+        return 2;
+    }
+    int repeat = 5;
+    for (int i = 1; i + 1 < argc; ++i)
+    {
+        if (strcmp(argv[i], "--repeat") == 0)
+            repeat = max(1, atoi(argv[++i]));
+    }
+
+    std::vector<Event> events;
+    WsTrace::FileHeader hdr;
+    if (!loadTrace(argv[0], events, hdr))
+        return 1;
+
+    FakeClock::setVirtual(true);
+    Serial.muted = true;
+    setup();
+    WebSocketsServer *ws = Network::getWebSocketServer();
+
+    uint64_t span = events.empty() ? 0 : events.back().tUs;
+    std::vector<double> cost(events.size(), 1e300);
+    std::string scratch;
+    for (int r = 0; r < repeat; ++r)
+    {
+        // 录制中途开始时，先让尚未出现 connect 的客户端处于已连接状态（不计时）
+        bool seen[WEBSOCKETS_SERVER_CLIENT_MAX] = {};
+        for (const Event &ev : events)
+        {
+            if (ev.client >= WEBSOCKETS_SERVER_CLIENT_MAX || seen[ev.client])
+                continue;
+            seen[ev.client] = true;
+            if (ev.type != WsTrace::EV_CONNECT)
+                ws->fakeConnect(ev.client);
+        }
+        uint64_t base = FakeClock::nowMicros();
+        for (size_t i = 0; i < events.size(); ++i)
+        {
+            // 虚拟时钟跟随录制时间戳，保证时间相关逻辑（uptime、快照缓存等）与现场一致
+            FakeClock::setMicros(base + events[i].tUs);
+            cost[i] = min(cost[i], dispatch(ws, events[i], scratch));
+        }
+        for (uint8_t c = 0; c < WEBSOCKETS_SERVER_CLIENT_MAX; ++c)
+            ws->fakeDisconnect(c);
+        FakeClock::setMicros(base + span + 1000000);
+    }
+
+    // 逐事件输出（取多次回放中的最小值以降低噪声），最后输出按类型汇总
+    struct Agg
+    {
+        std::vector<double> v;
+    };
+    std::map<std::string, Agg> byKind;
+    double total = 0;
+    for (size_t i = 0; i < events.size(); ++i)
+    {
+        const Event &ev = events[i];
+        printf("{\"type\":\"event\",\"i\":%zu,\"t_us\":%llu,\"ev\":\"%s\",\"client\":%u,\"len\":%zu,\"kind\":\"%s\",\"cost_ns\":%.0f}\n",
+               i, (unsigned long long)ev.tUs, typeName(ev.type), ev.client, ev.payload.size(), ev.kind.c_str(), cost[i]);
+        byKind[ev.kind].v.push_back(cost[i]);
+        total += cost[i];
+    }
+    printf("{\"type\":\"summary\",\"events\":%zu,\"evicted\":%u,\"repeat\":%d,\"total_ns\":%.0f,\"by_kind\":{",
+           events.size(), hdr.evicted, repeat, total);
+    bool first = true;
+    for (auto &kv : byKind)
+    {
+        std::vector<double> &v = kv.second.v;
+        std::sort(v.begin(), v.end());
+        double sum = 0;
+        for (double x : v)
+            sum += x;
+        printf("%s\"%s\":{\"n\":%zu,\"mean_ns\":%.0f,\"p50_ns\":%.0f,\"max_ns\":%.0f}",
+               first ? "" : ",", kv.first.c_str(), v.size(), sum / v.size(), v[v.size() / 2], v.back());
+        first = false;
+    }
+    printf("}}\n");
+    return 0;
+}
+
+// 生成合成录制，便于在没有现场录制时复现典型流量模式
+int runTraceSynth(int argc, char **argv)
+{
+    if (argc < 1)
+    {
+        fprintf(stderr, "usage: trace-synth <out.bin> [--scenario slider|reconnect|stream]\n");
+        return 2;
+    }
+    const char *scenario = "slider";
+    for (int i = 1; i + 1 < argc; ++i)
+    {
+        if (strcmp(argv[i], "--scenario") == 0)
+            scenario = argv[++i];
+    }
+    FILE *f = fopen(argv[0], "wb");
+    if (!f)
+    {
+        fprintf(stderr, "cannot open %s\n", argv[0]);
+        return 1;
+    }
+    WsTrace::FileHeader hdr{};
+    fwrite(&hdr, sizeof(hdr), 1, f);
+    synthLastUs = 0;
+    uint32_t n = 0;
+    char buf[96];
+    if (strcmp(scenario, "reconnect") == 0)
+    {
+        // 重连风暴：AP 重启后 5 个客户端在数毫秒内反复断开重连并请求状态
+        uint32_t t = 0;
+        for (int round = 0; round < 50; ++round)
+        {
+            for (uint8_t c = 0; c < 5; ++c, t += 2000)
+            {
+                putEmpty(f, t, WsTrace::EV_CONNECT, c);
+                putRecord(f, t + 500, WsTrace::EV_TEXT, c, "{\"cmd\":\"get_status\"}");
+                n += 2;
+            }
+            for (uint8_t c = 0; c < 5; ++c, t += 1000)
+            {
+                putEmpty(f, t, WsTrace::EV_DISCONNECT, c);
+                n++;
+            }
+        }
+    }
+    else if (strcmp(scenario, "stream") == 0)
+    {
+        // 流式播放：与 slider 相同的亮度曲线改为 100 fps 二进制帧，到达时间带 ±4ms 抖动
+        putEmpty(f, 0, WsTrace::EV_CONNECT, 0);
+        putRecord(f, 5000, WsTrace::EV_TEXT, 0, "{\"cmd\":\"stream_start\",\"delay_ms\":60}");
+        n += 2;
+        uint32_t seed = 1;
+        for (int i = 0; i < 400; ++i)
+        {
+            seed = seed * 1103515245u + 12345u;
+            int jitterUs = (int)((seed >> 16) % 8001) - 4000;
+            uint32_t tMs = (uint32_t)i * 10;
+            uint8_t frame[7] = {0x01, 1, (uint8_t)tMs, (uint8_t)(tMs >> 8), (uint8_t)(tMs >> 16), (uint8_t)(tMs >> 24), (uint8_t)((i * 7) % 256)};
+            putRecord(f, 10000 + i * 10000 + jitterUs, WsTrace::EV_BIN, 0, frame, sizeof(frame));
+            n++;
+        }
+        putRecord(f, 10000 + 400 * 10000, WsTrace::EV_TEXT, 0, "{\"cmd\":\"stream_stop\"}");
+        n++;
+    }
+    else
+    {
+        // 亮度滑块拖动：单客户端每 20ms 发送一次 set_brightness
+        putEmpty(f, 0, WsTrace::EV_CONNECT, 0);
+        n++;
+        for (int i = 0; i < 200; ++i)
+        {
+            snprintf(buf, sizeof(buf), "{\"cmd\":\"set_brightness\",\"duty\":%d}", (i * 7) % 256);
+            putRecord(f, 10000 + i * 20000, WsTrace::EV_TEXT, 0, buf);
+            n++;
+        }
+        putRecord(f, 10000 + 200 * 20000, WsTrace::EV_TEXT, 0, "{\"cmd\":\"get_status\"}");
+        n++;
+    }
+    WsTrace::fillFileHeader(hdr);
+    hdr.count = n;
+    hdr.evicted = 0;
+    fseek(f, 0, SEEK_SET);
+    fwrite(&hdr, sizeof(hdr), 1, f);
+    fclose(f);
+    return 0;
+}
@@ -0,0 +1,57 @@
+// 波形导出：在虚拟时钟上运行 LedController，输出 Recorder 后端记录的占空比变化点
+// 用于比较两个版本的波形是否一致（需以 -DLED_OUTPUT=LED_OUTPUT_RECORDER 构建，native 环境默认如此）
+#include <Arduino.h>
+#include <WebSocketsServer.h>
+#include "host_tools.h"
+#include "led_controller.h"
+#include "led_output.h"
+#include "network.h"
+
+void setup();
+
+int runWaveform(int argc, char **argv)
+{
+#if LED_OUTPUT != LED_OUTPUT_RECORDER
+    fprintf(stderr, "waveform requires -DLED_OUTPUT=LED_OUTPUT_RECORDER\n");
+    return 2;
+#else
+    const char *command = "{\"cmd\":\"set_mode\",\"mode\":\"breathe\",\"period_ms\":1500}";
+    uint32_t durationMs = 3000;
+    uint32_t stepUs = 1000;
+    for (int i = 0; i + 1 < argc; ++i)
+    {
+        if (strcmp(argv[i], "--cmd") == 0)
+            command = argv[++i];
+        else if (strcmp(argv[i], "--ms") == 0)
+            durationMs = (uint32_t)atoi(argv[++i]);
+        else if (strcmp(argv[i], "--step-us") == 0)
+            stepUs = max(1, atoi(argv[++i]));
+    }
+
+    FakeClock::setVirtual(true);
+    Serial.muted = true;
+    setup();
+    WebSocketsServer *ws = Network::getWebSocketServer();
+    ws->fakeConnect(0);
+    ws->fakeText(0, command);
+
+    LedOutput::Recorder::clear();
+    uint64_t start = FakeClock::nowMicros();
+    while (FakeClock::nowMicros() - start < (uint64_t)durationMs * 1000)
+    {
+        FakeClock::advanceMicros(stepUs);
+        LedController::update();
+    }
+
+    // 时间戳相对于命令生效时刻；超过 Recorder 容量时只保留最近的变化点
+    uint32_t t0 = (uint32_t)start;
+    for (size_t i = 0; i < LedOutput::Recorder::size(); ++i)
+    {
+        const LedOutput::Recorder::Sample &s = LedOutput::Recorder::at(i);
+        printf("{\"t_us\":%u,\"duty\":%u}\n", s.tUs - t0, s.duty);
+    }
+    printf("{\"type\":\"summary\",\"mode\":\"%s\",\"writes\":%u,\"changes\":%zu}\n",
+           LedController::getModeStr(), LedOutput::Recorder::writeCount(), LedOutput::Recorder::size());
+    return 0;
+#endif
+}
@@ -0,0 +1,525 @@
+// WebSocket 负载生成器：N 个并发客户端按设定速率与比例发送命令，
+// 统计吞吐、命令到状态广播的延迟分位数、错误与 dropped 计数，用于长时间浸泡测试
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <chrono>
+#include <deque>
+#include <random>
+#include <vector>
+#include "host_tools.h"
+
+namespace
+{
+    enum Kind
+    {
+        KIND_SET_MODE,
+        KIND_SET_BRIGHTNESS,
+        KIND_GET_STATUS,
+        KIND_COUNT
+    };
+
+    const char *const kindNames[KIND_COUNT] = {"set_mode", "set_brightness", "get_status"};
+
+    // 超过该时长仍未等到对应 ack 的命令计为超时
+    constexpr uint64_t PENDING_TIMEOUT_US = 2000000;
+
+    struct Pending
+    {
+        uint64_t sentUs;
+        uint32_t reqId;
+    };
+
+    struct Client
+    {
+        int fd = -1;
+        std::string in;
+        uint64_t nextSendUs = 0;
+        uint32_t nextReqId = 1;
+        uint64_t lastStatusUs = 0; // 最近一条状态消息的接收时间
+        std::deque<Pending> pending;
+    };
+
+    struct Stats
+    {
+        uint64_t sent = 0;
+        uint64_t received = 0;
+        uint64_t errors = 0;
+        uint64_t timeouts = 0;
+        uint64_t alerts = 0;
+        uint64_t alertDropped = 0;
+        int maxDropped = 0;
+        std::vector<uint32_t> latencies;
+    };
+
+    struct Options
+    {
+        const char *host = "127.0.0.1";
+        int port = 8181;
+        int clients = 4;
+        double rate = 10; // 每个客户端每秒命令数
+        int weights[KIND_COUNT] = {1, 3, 1};
+        double duration = 30;
+        double report = 5;
+    };
+
+    std::mt19937 rng(12345);
+
+    uint64_t nowUs()
+    {
+        using namespace std::chrono;
+        return (uint64_t)duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+    }
+
+    bool parseMix(const char *s, int *weights)
+    {
+        for (int k = 0; k < KIND_COUNT; ++k)
+            weights[k] = 0;
+        std::string mix(s);
+        size_t pos = 0;
+        while (pos < mix.size())
+        {
+            size_t comma = mix.find(',', pos);
+            std::string item = mix.substr(pos, comma == std::string::npos ? std::string::npos : comma - pos);
+            size_t eq = item.find('=');
+            if (eq == std::string::npos)
+                return false;
+            std::string name = item.substr(0, eq);
+            int w = atoi(item.c_str() + eq + 1);
+            bool found = false;
+            for (int k = 0; k < KIND_COUNT; ++k)
+            {
+                if (name == kindNames[k])
+                {
+                    weights[k] = w;
+                    found = true;
+                }
+            }
+            if (!found)
+                return false;
+            if (comma == std::string::npos)
+                break;
+            pos = comma + 1;
+        }
+        return true;
+    }
+
+    bool sendFrame(int fd, const std::string &text)
+    {
+        // 客户端到服务器的帧必须带掩码
+        std::string frame;
+        frame += (char)0x81;
+        size_t len = text.size();
+        if (len < 126)
+        {
+            frame += (char)(0x80 | len);
+        }
+        else
+        {
+            frame += (char)(0x80 | 126);
+            frame += (char)(len >> 8);
+            frame += (char)len;
+        }
+        uint8_t mask[4];
+        for (uint8_t &m : mask)
+            m = (uint8_t)rng();
+        frame.append((const char *)mask, 4);
+        for (size_t i = 0; i < len; ++i)
+            frame += (char)(text[i] ^ mask[i & 3]);
+        size_t off = 0;
+        while (off < frame.size())
+        {
+            ssize_t n = ::send(fd, frame.data() + off, frame.size() - off, MSG_NOSIGNAL);
+            if (n > 0)
+            {
+                off += (size_t)n;
+                continue;
+            }
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            {
+                pollfd p{fd, POLLOUT, 0};
+                if (::poll(&p, 1, 1000) <= 0)
+                    return false;
+                continue;
+            }
+            return false;
+        }
+        return true;
+    }
+
+    int connectClient(const Options &opt)
+    {
+        addrinfo hints{}, *res = nullptr;
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_STREAM;
+        char port[8];
+        snprintf(port, sizeof(port), "%d", opt.port);
+        if (getaddrinfo(opt.host, port, &hints, &res) != 0)
+            return -1;
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (::connect(fd, res->ai_addr, res->ai_addrlen) != 0)
+        {
+            freeaddrinfo(res);
+            ::close(fd);
+            return -1;
+        }
+        freeaddrinfo(res);
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        std::string req = std::string("GET / HTTP/1.1\r\nHost: ") + opt.host +
+                          "\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                          "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n\r\n";
+        if (::send(fd, req.data(), req.size(), MSG_NOSIGNAL) != (ssize_t)req.size())
+        {
+            ::close(fd);
+            return -1;
+        }
+        // 逐字节读到响应头结束，避免吞掉紧随其后的首个帧
+        std::string resp;
+        char c;
+        pollfd p{fd, POLLIN, 0};
+        while (resp.size() < 1024 && resp.find("\r\n\r\n") == std::string::npos)
+        {
+            if (::poll(&p, 1, 2000) <= 0 || ::recv(fd, &c, 1, 0) != 1)
+            {
+                ::close(fd);
+                return -1;
+            }
+            resp += c;
+        }
+        if (resp.compare(0, 12, "HTTP/1.1 101") != 0)
+        {
+            ::close(fd);
+            return -1;
+        }
+        fcntl(fd, F_SETFL, O_NONBLOCK);
+        return fd;
+    }
+
+    Kind pickKind(const Options &opt)
+    {
+        int total = 0;
+        for (int w : opt.weights)
+            total += w;
+        int r = (int)(rng() % (uint32_t)max(1, total));
+        for (int k = 0; k < KIND_COUNT; ++k)
+        {
+            if (r < opt.weights[k])
+                return (Kind)k;
+            r -= opt.weights[k];
+        }
+        return KIND_GET_STATUS;
+    }
+
+    bool sendCommand(Client &c, const Options &opt, Stats &st)
+    {
+        Kind kind = pickKind(opt);
+        char buf[128];
+        uint32_t reqId = c.nextReqId++;
+        switch (kind)
+        {
+        case KIND_SET_MODE:
+            snprintf(buf, sizeof(buf), "{\"cmd\":\"set_mode\",\"mode\":\"blink\",\"hz\":%d,\"req_id\":%u}", 1 + (int)(rng() % 20), reqId);
+            break;
+        case KIND_SET_BRIGHTNESS:
+            snprintf(buf, sizeof(buf), "{\"cmd\":\"set_brightness\",\"duty\":%d,\"req_id\":%u}", (int)(rng() % 256), reqId);
+            break;
+        default:
+            snprintf(buf, sizeof(buf), "{\"cmd\":\"get_status\",\"req_id\":%u}", reqId);
+            break;
+        }
+        c.pending.push_back(Pending{nowUs(), reqId});
+        st.sent++;
+        return sendFrame(c.fd, buf);
+    }
+
+    // 按 req_id 找到 ack 对应的命令。设备处理命令时先发出状态消息（set_* 的广播或 get_status 的单发回复），
+    // 随后才回复 ack，两者之间不会插入其他消息；因此 ack 之前最后一条状态消息就是该命令引起的，
+    // 心跳和其他客户端命令引起的广播不会被误配
+    void onAck(Client &c, JsonDocument &doc, Stats &st)
+    {
+        uint32_t reqId = doc["req_id"] | 0u;
+        for (auto it = c.pending.begin(); it != c.pending.end(); ++it)
+        {
+            if (it->reqId != reqId)
+                continue;
+            // 失败的命令已计入 errors；推流期间不广播状态，没有对应的状态消息时不计延迟
+            if ((doc["ok"] | false) && c.lastStatusUs >= it->sentUs)
+                st.latencies.push_back((uint32_t)(c.lastStatusUs - it->sentUs));
+            c.pending.erase(it);
+            return;
+        }
+    }
+
+    void onMessage(Client &c, const std::string &text, Stats &st, uint64_t now)
+    {
+        st.received++;
+        StaticJsonDocument<512> doc;
+        if (deserializeJson(doc, text.data(), text.size()))
+            return;
+        const char *evt = doc["evt"] | "";
+        if (strcmp(evt, "status") == 0)
+        {
+            c.lastStatusUs = now;
+            int dropped = doc["dropped"] | 0;
+            st.maxDropped = max(st.maxDropped, dropped);
+        }
+        else if (strcmp(evt, "ack") == 0)
+        {
+            onAck(c, doc, st);
+        }
+        else if (strcmp(evt, "error") == 0)
+        {
+            // 命令随后的 ack（ok 为 false）结束对应的未完成命令
+            st.errors++;
+        }
+        else if (strcmp(evt, "alert") == 0)
+        {
+            st.alerts++;
+            st.alertDropped += doc["dropped"] | 0;
+        }
+    }
+
+    // 读取并拆分服务器帧（服务器到客户端的帧不带掩码）；连接关闭时返回 false
+    bool pumpClient(Client &c, Stats &st)
+    {
+        char buf[4096];
+        for (;;)
+        {
+            ssize_t n = ::recv(c.fd, buf, sizeof(buf), 0);
+            if (n > 0)
+            {
+                c.in.append(buf, (size_t)n);
+                continue;
+            }
+            if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK))
+                return false;
+            break;
+        }
+        uint64_t now = nowUs();
+        while (c.in.size() >= 2)
+        {
+            const uint8_t *p = (const uint8_t *)c.in.data();
+            uint8_t opcode = p[0] & 0x0F;
+            uint64_t len = p[1] & 0x7F;
+            size_t pos = 2;
+            if (len == 126)
+            {
+                if (c.in.size() < 4)
+                    break;
+                len = (uint64_t)p[2] << 8 | p[3];
+                pos = 4;
+            }
+            else if (len == 127)
+            {
+                if (c.in.size() < 10)
+                    break;
+                len = 0;
+                for (int i = 0; i < 8; ++i)
+                    len = len << 8 | p[2 + i];
+                pos = 10;
+            }
+            if (c.in.size() < pos + len)
+                break;
+            std::string payload = c.in.substr(pos, (size_t)len);
+            c.in.erase(0, pos + (size_t)len);
+            if (opcode == 0x1)
+                onMessage(c, payload, st, now);
+            else if (opcode == 0x8)
+                return false;
+        }
+        return true;
+    }
+
+    void expirePending(Client &c, Stats &st, uint64_t now)
+    {
+        while (!c.pending.empty() && now - c.pending.front().sentUs > PENDING_TIMEOUT_US)
+        {
+            c.pending.pop_front();
+            st.timeouts++;
+        }
+    }
+
+    uint32_t percentile(std::vector<uint32_t> &v, double q)
+    {
+        if (v.empty())
+            return 0;
+        size_t idx = (size_t)(q * (double)(v.size() - 1));
+        std::nth_element(v.begin(), v.begin() + idx, v.end());
+        return v[idx];
+    }
+
+    void report(const char *kind, double elapsed, double window, Stats &st, int connected, int rejected, int disconnects)
+    {
+        std::vector<uint32_t> &lat = st.latencies;
+        uint32_t maxLat = lat.empty() ? 0 : *std::max_element(lat.begin(), lat.end());
+        uint32_t p50 = percentile(lat, 0.50);
+        uint32_t p99 = percentile(lat, 0.99);
+        printf("{\"type\":\"%s\",\"t\":%.1f,\"connected\":%d,\"rejected\":%d,\"disconnects\":%d,"
+               "\"sent\":%llu,\"received\":%llu,\"cmd_per_s\":%.1f,"
+               "\"latency_us\":{\"n\":%zu,\"p50\":%u,\"p99\":%u,\"max\":%u},"
+               "\"errors\":%llu,\"timeouts\":%llu,\"backpressure_alerts\":%llu,\"alert_dropped\":%llu,\"max_dropped\":%d}\n",
+               kind, elapsed, connected, rejected, disconnects,
+               (unsigned long long)st.sent, (unsigned long long)st.received, window > 0 ? (double)st.sent / window : 0.0,
+               lat.size(), p50, p99, maxLat,
+               (unsigned long long)st.errors, (unsigned long long)st.timeouts,
+               (unsigned long long)st.alerts, (unsigned long long)st.alertDropped, st.maxDropped);
+        fflush(stdout);
+    }
+
+    void mergeInto(Stats &total, const Stats &win)
+    {
+        total.sent += win.sent;
+        total.received += win.received;
+        total.errors += win.errors;
+        total.timeouts += win.timeouts;
+        total.alerts += win.alerts;
+        total.alertDropped += win.alertDropped;
+        total.maxDropped = max(total.maxDropped, win.maxDropped);
+        total.latencies.insert(total.latencies.end(), win.latencies.begin(), win.latencies.end());
+    }
+}
+
+int runLoad(int argc, char **argv)
+{
+    Options opt;
+    for (int i = 0; i < argc; ++i)
+    {
+        const char *a = argv[i];
+        const char *v = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (!v)
+            break;
+        if (strcmp(a, "--host") == 0)
+            opt.host = v;
+        else if (strcmp(a, "--port") == 0)
+            opt.port = atoi(v);
+        else if (strcmp(a, "--clients") == 0)
+            opt.clients = atoi(v);
+        else if (strcmp(a, "--rate") == 0)
+            opt.rate = atof(v);
+        else if (strcmp(a, "--duration") == 0)
+            opt.duration = atof(v);
+        else if (strcmp(a, "--report") == 0)
+            opt.report = atof(v);
+        else if (strcmp(a, "--mix") == 0)
+        {
+            if (!parseMix(v, opt.weights))
+            {
+                fprintf(stderr, "bad --mix, expected e.g. set_mode=1,set_brightness=3,get_status=1\n");
+                return 2;
+            }
+        }
+        else
+            continue;
+        ++i;
+    }
+
+    std::vector<Client> clients;
+    int rejected = 0;
+    uint64_t interval = opt.rate > 0 ? (uint64_t)(1e6 / opt.rate) : 0;
+    uint64_t start = nowUs();
+    for (int i = 0; i < opt.clients; ++i)
+    {
+        Client c;
+        c.fd = connectClient(opt);
+        if (c.fd < 0)
+        {
+            rejected++;
+            continue;
+        }
+        // 随机相位，避免所有客户端同时发送
+        c.nextSendUs = start + (interval ? rng() % interval : 0);
+        clients.push_back(std::move(c));
+    }
+
+    Stats total, win;
+    int disconnects = 0;
+    uint64_t end = start + (uint64_t)(opt.duration * 1e6);
+    uint64_t nextReport = start + (uint64_t)(opt.report * 1e6);
+    uint64_t winStart = start;
+    std::vector<pollfd> pfds;
+    for (;;)
+    {
+        uint64_t now = nowUs();
+        if (now >= end)
+            break;
+
+        // 到期的客户端发送命令
+        uint64_t wake = min(end, nextReport);
+        int connected = 0;
+        for (Client &c : clients)
+        {
+            if (c.fd < 0)
+                continue;
+            connected++;
+            if (interval && now >= c.nextSendUs)
+            {
+                if (!sendCommand(c, opt, win))
+                {
+                    ::close(c.fd);
+                    c.fd = -1;
+                    disconnects++;
+                    continue;
+                }
+                c.nextSendUs += interval;
+                if (c.nextSendUs < now)
+                    c.nextSendUs = now + interval;
+            }
+            if (interval)
+                wake = min(wake, c.nextSendUs);
+        }
+
+        pfds.clear();
+        for (Client &c : clients)
+            pfds.push_back(pollfd{c.fd, POLLIN, 0});
+        int timeoutMs = wake > now ? (int)((wake - now + 999) / 1000) : 0;
+        ::poll(pfds.data(), pfds.size(), timeoutMs);
+
+        now = nowUs();
+        for (size_t i = 0; i < clients.size(); ++i)
+        {
+            Client &c = clients[i];
+            if (c.fd < 0)
+                continue;
+            if ((pfds[i].revents & (POLLIN | POLLHUP | POLLERR)) && !pumpClient(c, win))
+            {
+                ::close(c.fd);
+                c.fd = -1;
+                disconnects++;
+                continue;
+            }
+            expirePending(c, win, now);
+        }
+
+        if (now >= nextReport)
+        {
+            report("interval", (double)(now - start) / 1e6, (double)(now - winStart) / 1e6, win, connected, rejected, disconnects);
+            mergeInto(total, win);
+            win = Stats();
+            winStart = now;
+            nextReport += (uint64_t)(opt.report * 1e6);
+        }
+    }
+
+    mergeInto(total, win);
+    int connected = 0;
+    for (Client &c : clients)
+    {
+        if (c.fd >= 0)
+        {
+            connected++;
+            ::close(c.fd);
+        }
+    }
+    double elapsed = (double)(nowUs() - start) / 1e6;
+    report("summary", elapsed, elapsed, total, connected, rejected, disconnects);
+    return 0;
+}
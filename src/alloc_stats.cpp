@@ -0,0 +1,57 @@
+#include "alloc_stats.h"
+#include <stddef.h>
+
+#ifdef ALLOC_HOOK
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+static volatile uint32_t totalAllocs = 0;
+static volatile uint32_t loopAllocs = 0;
+static TaskHandle_t loopTask = nullptr;
+
+static inline void countAlloc()
+{
+    totalAllocs++;
+    if (loopTask && xTaskGetCurrentTaskHandle() == loopTask)
+        loopAllocs++;
+}
+
+extern "C"
+{
+    void *__real_malloc(size_t size);
+    void *__real_calloc(size_t n, size_t size);
+    void *__real_realloc(void *ptr, size_t size);
+
+    void *__wrap_malloc(size_t size)
+    {
+        countAlloc();
+        return __real_malloc(size);
+    }
+
+    void *__wrap_calloc(size_t n, size_t size)
+    {
+        countAlloc();
+        return __real_calloc(n, size);
+    }
+
+    void *__wrap_realloc(void *ptr, size_t size)
+    {
+        countAlloc();
+        return __real_realloc(ptr, size);
+    }
+}
+
+void AllocStats::begin()
+{
+    loopTask = xTaskGetCurrentTaskHandle();
+}
+
+bool AllocStats::isEnabled() { return true; }
+uint32_t AllocStats::getTotal() { return totalAllocs; }
+uint32_t AllocStats::getLoopTask() { return loopAllocs; }
+#else
+void AllocStats::begin() {}
+bool AllocStats::isEnabled() { return false; }
+uint32_t AllocStats::getTotal() { return 0; }
+uint32_t AllocStats::getLoopTask() { return 0; }
+#endif
@@ -0,0 +1,15 @@
+#pragma once
+#include <stdint.h>
+
+// heap 分配计数：通过链接器 --wrap 包装 malloc/calloc/realloc 统计分配次数
+// 需要在 build_flags 中同时加入 -DALLOC_HOOK 与对应的 -Wl,--wrap=... 选项；未启用时计数恒为 0
+namespace AllocStats
+{
+    // 必须在 loop 任务中调用，记录 loop 任务以便单独统计其分配
+    void begin();
+    bool isEnabled();
+    // 所有任务的分配次数（多任务并发时为近似值）
+    uint32_t getTotal();
+    // 仅 loop 任务中的分配次数（精确），用于统计每条命令的分配
+    uint32_t getLoopTask();
+}
@@ -0,0 +1,171 @@
+#include "audio_input.h"
+#include <Arduino.h>
+#include <driver/adc.h>
+#include "dsp.h"
+#include "led_controller.h"
+
+// ADC1 通道（ESP32-C3：通道 n 对应 GPIOn，0..4）
+#ifndef AUDIO_ADC_CHANNEL
+#define AUDIO_ADC_CHANNEL 2
+#endif
+#ifndef AUDIO_SAMPLE_RATE
+#define AUDIO_SAMPLE_RATE 8000
+#endif
+// 每块样本数：8 kHz 下 128 个样本约 16 ms，决定了输入到 LED 的延迟上限
+#ifndef AUDIO_BLOCK_SAMPLES
+#define AUDIO_BLOCK_SAMPLES 128
+#endif
+#ifndef AUDIO_USE_FFT
+#define AUDIO_USE_FFT 0
+#endif
+
+namespace AudioInput
+{
+    constexpr size_t RAW_BYTES = AUDIO_BLOCK_SAMPLES * SOC_ADC_DIGI_RESULT_BYTES;
+
+    // 乒乓缓冲：一块读满后切换到另一块继续接收，已满的一块交给 DSP 处理
+    static uint8_t raw[2][RAW_BYTES];
+    static size_t filled = 0;
+    static int fillIdx = 0;
+    static int16_t samples[AUDIO_BLOCK_SAMPLES];
+    static int16_t scratch[AUDIO_BLOCK_SAMPLES];
+
+    static Dsp::AudioState state;
+    static const Dsp::AudioConfig config = {
+        8000, // attack：约 4 个样本内跟上
+        100,  // release：约 40 ms 衰减
+        32,   // 2 倍增益
+        AUDIO_USE_FFT != 0,
+        1, // 125..500 Hz（FFT_N=64、8 kHz 时每 bin 125 Hz）
+        4,
+    };
+
+    static bool initialized = false;
+    static bool running = false;
+    static uint32_t lastCostUs = 0;
+    static uint32_t avgCostUs = 0;
+    static uint32_t blocks = 0;
+
+    static bool init()
+    {
+        adc_digi_init_config_t init = {};
+        init.max_store_buf_size = RAW_BYTES * 4;
+        init.conv_num_each_intr = RAW_BYTES;
+        init.adc1_chan_mask = BIT(AUDIO_ADC_CHANNEL);
+        init.adc2_chan_mask = 0;
+        if (adc_digi_initialize(&init) != ESP_OK)
+            return false;
+
+        static adc_digi_pattern_config_t pattern = {};
+        pattern.atten = ADC_ATTEN_DB_11;
+        pattern.channel = AUDIO_ADC_CHANNEL;
+        pattern.unit = 0; // ADC1
+        pattern.bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+
+        adc_digi_configuration_t cfg = {};
+        cfg.conv_limit_en = false;
+        cfg.conv_limit_num = 250;
+        cfg.pattern_num = 1;
+        cfg.adc_pattern = &pattern;
+        cfg.sample_freq_hz = AUDIO_SAMPLE_RATE;
+        cfg.conv_mode = ADC_CONV_SINGLE_UNIT_1;
+        cfg.format = ADC_DIGI_OUTPUT_FORMAT_TYPE2;
+        return adc_digi_controller_configure(&cfg) == ESP_OK;
+    }
+
+    static void start()
+    {
+        if (!initialized)
+        {
+            initialized = init();
+            if (!initialized)
+            {
+                Serial.println("AudioInput: ADC init failed");
+                return;
+            }
+        }
+        memset(&state, 0, sizeof(state));
+        filled = 0;
+        if (adc_digi_start() == ESP_OK)
+            running = true;
+    }
+
+    static void stop()
+    {
+        adc_digi_stop();
+        running = false;
+        LedController::setAudioLevel(0);
+    }
+
+    // 12 位无符号 ADC 结果 -> 以 2048 为中点的 Q15 有符号样本
+    static size_t unpack(const uint8_t *buf, size_t bytes)
+    {
+        size_t n = 0;
+        for (size_t i = 0; i + SOC_ADC_DIGI_RESULT_BYTES <= bytes && n < AUDIO_BLOCK_SAMPLES; i += SOC_ADC_DIGI_RESULT_BYTES)
+        {
+            const adc_digi_output_data_t *p = (const adc_digi_output_data_t *)&buf[i];
+            if (p->type2.channel != AUDIO_ADC_CHANNEL)
+                continue;
+            samples[n++] = (int16_t)(((int32_t)p->type2.data - 2048) << 4);
+        }
+        return n;
+    }
+
+    void begin()
+    {
+        running = false;
+        initialized = false;
+    }
+
+    void loop()
+    {
+        bool want = strcmp(LedController::getModeStr(), "audio") == 0;
+        if (want && !running)
+            start();
+        else if (!want && running)
+            stop();
+        if (!running)
+            return;
+
+        // 非阻塞读取：只取驱动中已就绪的数据
+        uint32_t got = 0;
+        if (adc_digi_read_bytes(raw[fillIdx] + filled, RAW_BYTES - filled, &got, 0) != ESP_OK)
+            return;
+        filled += got;
+        if (filled < RAW_BYTES)
+            return;
+
+        const uint8_t *block = raw[fillIdx];
+        fillIdx ^= 1;
+        filled = 0;
+
+        unsigned long t0 = micros();
+        size_t n = unpack(block, RAW_BYTES);
+        uint8_t level = Dsp::processBlock(state, config, samples, n, scratch);
+        lastCostUs = micros() - t0;
+        // 指数平均（1/8）
+        avgCostUs = blocks ? avgCostUs + (((int32_t)lastCostUs - (int32_t)avgCostUs) >> 3) : lastCostUs;
+        blocks++;
+        LedController::setAudioLevel(level);
+    }
+
+    bool isRunning()
+    {
+        return running;
+    }
+
+    uint32_t getLastCostUs()
+    {
+        return lastCostUs;
+    }
+
+    uint32_t getAvgCostUs()
+    {
+        return avgCostUs;
+    }
+
+    uint32_t getBlocks()
+    {
+        return blocks;
+    }
+}
@@ -0,0 +1,16 @@
+#pragma once
+#include <stdint.h>
+
+// 音频/传感器输入：连续 ADC（DMA）采样，按块送入 Dsp 流水线，结果驱动 LedController 的 audio 模式
+// 仅在 LED 处于 audio 模式时采样；引脚与采样率可通过 build_flags 覆盖（见 audio_input.cpp）
+namespace AudioInput
+{
+    void begin();
+    // 在 loop 中调用：按 LED 模式启停采样，取出已就绪的数据块并处理
+    void loop();
+    bool isRunning();
+    // 每块的处理耗时（us）：最近一次与指数平均
+    uint32_t getLastCostUs();
+    uint32_t getAvgCostUs();
+    uint32_t getBlocks();
+}
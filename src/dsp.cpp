@@ -0,0 +1,149 @@
+#include "dsp.h"
+
+namespace Dsp
+{
+    // sin(2*pi*k/64) * 32767
+    static const int16_t SIN_TABLE[FFT_N] = {
+        0, 3212, 6393, 9512, 12539, 15446, 18204, 20787,
+        23170, 25329, 27245, 28898, 30273, 31356, 32137, 32609,
+        32767, 32609, 32137, 31356, 30273, 28898, 27245, 25329,
+        23170, 20787, 18204, 15446, 12539, 9512, 6393, 3212,
+        0, -3212, -6393, -9512, -12539, -15446, -18204, -20787,
+        -23170, -25329, -27245, -28898, -30273, -31356, -32137, -32609,
+        -32767, -32609, -32137, -31356, -30273, -28898, -27245, -25329,
+        -23170, -20787, -18204, -15446, -12539, -9512, -6393, -3212,
+    };
+
+    // 去直流极点 a = 0.995（Q15）
+    constexpr int32_t DC_POLE_Q15 = 32604;
+
+    static inline int16_t sat16(int32_t v)
+    {
+        return (int16_t)(v > 32767 ? 32767 : (v < -32768 ? -32768 : v));
+    }
+
+    void dcRemove(DcBlocker &st, const int16_t *in, int16_t *out, size_t n)
+    {
+        int32_t x1 = st.prevIn, y1 = st.prevOut;
+        for (size_t i = 0; i < n; ++i)
+        {
+            int32_t x = in[i];
+            int32_t y = x - x1 + ((DC_POLE_Q15 * y1) >> 15);
+            x1 = x;
+            y1 = sat16(y);
+            out[i] = (int16_t)y1;
+        }
+        st.prevIn = x1;
+        st.prevOut = y1;
+    }
+
+    uint16_t envelope(Envelope &st, const int16_t *in, size_t n, uint16_t attackQ15, uint16_t releaseQ15)
+    {
+        int32_t level = st.level;
+        for (size_t i = 0; i < n; ++i)
+        {
+            int32_t a = in[i] < 0 ? -(int32_t)in[i] : in[i];
+            int32_t coef = a > level ? attackQ15 : releaseQ15;
+            level += ((a - level) * coef) >> 15;
+        }
+        st.level = level;
+        return (uint16_t)(level > 32767 ? 32767 : level);
+    }
+
+    void fftQ15(int16_t *re, int16_t *im)
+    {
+        // 位反转重排
+        for (int i = 1, j = 0; i < FFT_N; ++i)
+        {
+            int bit = FFT_N >> 1;
+            for (; j & bit; bit >>= 1)
+                j ^= bit;
+            j |= bit;
+            if (i < j)
+            {
+                int16_t t = re[i];
+                re[i] = re[j];
+                re[j] = t;
+                t = im[i];
+                im[i] = im[j];
+                im[j] = t;
+            }
+        }
+        for (int size = 2; size <= FFT_N; size <<= 1)
+        {
+            int half = size >> 1;
+            int step = FFT_N / size;
+            for (int i = 0; i < FFT_N; i += size)
+            {
+                for (int j = 0; j < half; ++j)
+                {
+                    int k = j * step;
+                    int32_t wr = SIN_TABLE[(k + FFT_N / 4) & (FFT_N - 1)]; // cos
+                    int32_t wi = -SIN_TABLE[k];                            // -sin
+                    int a = i + j, b = a + half;
+                    int32_t tr = (wr * re[b] - wi * im[b]) >> 15;
+                    int32_t ti = (wr * im[b] + wi * re[b]) >> 15;
+                    int32_t ar = re[a], ai = im[a];
+                    re[b] = (int16_t)((ar - tr) >> 1);
+                    im[b] = (int16_t)((ai - ti) >> 1);
+                    re[a] = (int16_t)((ar + tr) >> 1);
+                    im[a] = (int16_t)((ai + ti) >> 1);
+                }
+            }
+        }
+    }
+
+    uint64_t bandEnergy(const int16_t *re, const int16_t *im, int lo, int hi)
+    {
+        uint64_t e = 0;
+        for (int k = lo; k <= hi && k < FFT_N; ++k)
+            e += (uint64_t)((int32_t)re[k] * re[k]) + (uint64_t)((int32_t)im[k] * im[k]);
+        return e;
+    }
+
+    uint32_t isqrt(uint64_t v)
+    {
+        uint64_t r = 0, bit = (uint64_t)1 << 62;
+        while (bit > v)
+            bit >>= 2;
+        while (bit)
+        {
+            if (v >= r + bit)
+            {
+                v -= r + bit;
+                r = (r >> 1) + bit;
+            }
+            else
+            {
+                r >>= 1;
+            }
+            bit >>= 2;
+        }
+        return (uint32_t)r;
+    }
+
+    uint8_t processBlock(AudioState &st, const AudioConfig &cfg, const int16_t *in, size_t n, int16_t *scratch)
+    {
+        dcRemove(st.dc, in, scratch, n);
+        int32_t level = envelope(st.env, scratch, n, cfg.attackQ15, cfg.releaseQ15);
+        if (cfg.useFft && n >= (size_t)FFT_N)
+        {
+            // 对块内最后 FFT_N 个样本做 FFT；正弦幅度 A 在对应 bin 的幅值约为 A/2，乘 2 还原
+            int16_t re[FFT_N], im[FFT_N];
+            for (int i = 0; i < FFT_N; ++i)
+            {
+                re[i] = scratch[n - FFT_N + i];
+                im[i] = 0;
+            }
+            fftQ15(re, im);
+            uint32_t amp = isqrt(bandEnergy(re, im, cfg.bandLo, cfg.bandHi)) * 2;
+            int16_t bandSample = (int16_t)(amp > 32767 ? 32767 : amp);
+            // 每块一个样本，同样经过包络平滑；系数放大以补偿较低的更新率
+            uint32_t attack = (uint32_t)cfg.attackQ15 * 16;
+            uint32_t release = (uint32_t)cfg.releaseQ15 * 16;
+            level = envelope(st.band, &bandSample, 1, (uint16_t)(attack > 32767 ? 32767 : attack), (uint16_t)(release > 32767 ? 32767 : release));
+        }
+        int32_t duty = (level * cfg.gain) >> 11;
+        return (uint8_t)(duty > 255 ? 255 : duty);
+    }
+}
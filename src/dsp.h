@@ -0,0 +1,54 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// 音频/传感器响应模式的定点信号处理：全部为纯函数，状态由调用方持有，
+// 不依赖任何硬件接口，可在主机上用合成输入做基准测试
+namespace Dsp
+{
+    constexpr int FFT_LOG2N = 6;
+    constexpr int FFT_N = 1 << FFT_LOG2N;
+
+    // 一阶高通去直流：y[n] = x[n] - x[n-1] + a * y[n-1]
+    struct DcBlocker
+    {
+        int32_t prevIn;
+        int32_t prevOut;
+    };
+
+    // 包络跟随：电平为 Q15（0..32767）
+    struct Envelope
+    {
+        int32_t level;
+    };
+
+    struct AudioConfig
+    {
+        uint16_t attackQ15;  // 电平上升时的平滑系数（越大越快）
+        uint16_t releaseQ15; // 电平下降时的平滑系数
+        uint8_t gain;        // 16 = 1 倍
+        bool useFft;         // true 时以频带能量代替宽带包络
+        uint8_t bandLo;      // 频带起止 FFT bin（含）
+        uint8_t bandHi;
+    };
+
+    struct AudioState
+    {
+        DcBlocker dc;
+        Envelope env;
+        Envelope band;
+    };
+
+    void dcRemove(DcBlocker &st, const int16_t *in, int16_t *out, size_t n);
+    // 返回处理完 n 个样本后的包络电平（Q15）
+    uint16_t envelope(Envelope &st, const int16_t *in, size_t n, uint16_t attackQ15, uint16_t releaseQ15);
+    // 原地 FFT_N 点基 2 FFT，每级右移 1 位防溢出（结果整体缩放 1/FFT_N）
+    void fftQ15(int16_t *re, int16_t *im);
+    // bin [lo, hi] 的能量（幅度平方和）
+    uint64_t bandEnergy(const int16_t *re, const int16_t *im, int lo, int hi);
+    uint32_t isqrt(uint64_t v);
+
+    // 完整流水线：去直流 -> 包络（可选 FFT 频带能量）-> 占空比 0..255
+    // scratch 至少需要 n 个元素（n >= FFT_N 时才会做 FFT）
+    uint8_t processBlock(AudioState &st, const AudioConfig &cfg, const int16_t *in, size_t n, int16_t *scratch);
+}
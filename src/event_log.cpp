@@ -0,0 +1,135 @@
+#include "event_log.h"
+#include <Arduino.h>
+
+namespace EventLog
+{
+    struct Slot
+    {
+        uint32_t seq; // 0 表示空槽
+        uint16_t len; // 0 表示事件过大未保留
+        bool delivered;
+        char data[SLOT_SIZE];
+    };
+
+    static Slot ring[CAPACITY]; // 非合并事件，按写入顺序循环覆盖
+    static uint32_t ringWritten = 0;
+    static Slot latest;            // 最新的可合并事件（状态快照）
+    static uint32_t gapSeq = 0;    // 已丢失（被覆盖或过大未保留）的非合并事件中的最大序号
+    static uint32_t lastSeq = 0;
+    static uint32_t epoch = 0;
+    static uint32_t lost = 0;
+
+    void begin()
+    {
+        memset(ring, 0, sizeof(ring));
+        memset(&latest, 0, sizeof(latest));
+        ringWritten = 0;
+        gapSeq = 0;
+        lastSeq = 0;
+        lost = 0;
+        epoch = esp_random();
+    }
+
+    // 在对象的左花括号后插入 prefix；json 不是对象或放不下时返回 0
+    static size_t insertFields(char *dst, size_t cap, const char *prefix, const char *json, size_t len)
+    {
+        if (len < 2 || json[0] != '{')
+            return 0;
+        size_t plen = strlen(prefix);
+        bool empty = json[1] == '}';
+        size_t total = 1 + plen + (empty ? 0 : 1) + len - 1;
+        if (total > cap)
+            return 0;
+        dst[0] = '{';
+        memcpy(dst + 1, prefix, plen);
+        size_t n = 1 + plen;
+        if (!empty)
+            dst[n++] = ',';
+        memcpy(dst + n, json + 1, len - 1);
+        return total;
+    }
+
+    const char *append(const char *json, size_t len, bool delivered, bool coalesce, size_t &outLen)
+    {
+        lastSeq++;
+        Slot *s = &latest;
+        if (!coalesce)
+        {
+            s = &ring[ringWritten++ % CAPACITY];
+            if (s->seq)
+            {
+                gapSeq = s->seq;
+                // 有客户端在线时覆盖的未送达事件不计入：在线的客户端已收到快照
+                if (!s->delivered && !delivered)
+                    lost++;
+            }
+        }
+        s->seq = lastSeq;
+        s->delivered = delivered;
+        char prefix[24];
+        snprintf(prefix, sizeof(prefix), "\"seq\":%u", (unsigned)lastSeq);
+        s->len = (uint16_t)insertFields(s->data, sizeof(s->data), prefix, json, len);
+        if (s->len == 0 && !coalesce)
+            gapSeq = lastSeq;
+        outLen = s->len;
+        return s->len ? s->data : nullptr;
+    }
+
+    int replay(uint32_t afterSeq, void (*send)(uint8_t num, const char *s, size_t len), uint8_t num)
+    {
+        // 序号超前（设备重启过）、需要的非合并事件已丢失、或需要的最新状态过大未保留
+        if (afterSeq > lastSeq || gapSeq > afterSeq)
+            return -1;
+        bool needLatest = latest.seq > afterSeq;
+        if (needLatest && latest.len == 0)
+            return -1;
+        int sent = 0;
+        uint32_t count = min<uint32_t>(ringWritten, CAPACITY);
+        for (uint32_t k = ringWritten - count; k < ringWritten; ++k)
+        {
+            Slot &s = ring[k % CAPACITY];
+            if (s.seq <= afterSeq)
+                continue;
+            // 最新状态按序号插在对应位置
+            if (needLatest && latest.seq < s.seq)
+            {
+                send(num, latest.data, latest.len);
+                latest.delivered = true;
+                needLatest = false;
+                sent++;
+            }
+            send(num, s.data, s.len);
+            s.delivered = true;
+            sent++;
+        }
+        if (needLatest)
+        {
+            send(num, latest.data, latest.len);
+            latest.delivered = true;
+            sent++;
+        }
+        return sent;
+    }
+
+    size_t stampSnapshot(char *dst, size_t cap, const char *json, size_t len)
+    {
+        char prefix[48];
+        snprintf(prefix, sizeof(prefix), "\"seq\":%u,\"epoch\":%u", (unsigned)lastSeq, (unsigned)epoch);
+        return insertFields(dst, cap, prefix, json, len);
+    }
+
+    uint32_t getLastSeq()
+    {
+        return lastSeq;
+    }
+
+    uint32_t getEpoch()
+    {
+        return epoch;
+    }
+
+    uint32_t getLost()
+    {
+        return lost;
+    }
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// 广播事件日志：每条广播事件发出前插入递增的序号（"seq"），补发时只发送客户端缺失的部分。
+// 状态快照（周期心跳与状态变化）是可合并的：只保留最新一条，旧的被新的取代，不占用环形缓冲；
+// 其他事件保留在 RAM 环形缓冲中。缺失的非合并事件已被覆盖、或设备重启过（epoch 不同）时改发状态快照
+namespace EventLog
+{
+    constexpr int CAPACITY = 16;
+    constexpr size_t SLOT_SIZE = 352;
+
+    void begin();
+    // 为 JSON 对象事件分配下一个序号并保存；delivered 表示已发给至少一个客户端，
+    // coalesce 表示该事件完整描述当前状态（只保留最新一条）。
+    // 返回带 seq 字段的事件（在被覆盖前有效）；事件放不进槽位时不保留、返回 nullptr，补发时视为缺口
+    const char *append(const char *json, size_t len, bool delivered, bool coalesce, size_t &outLen);
+    // 按序号顺序把 afterSeq 之后的事件交给 send：非合并事件逐条发送，被取代的旧状态跳过、只发最新一条；
+    // 有任何需要的事件已不在缓冲中时不发送并返回 -1，否则返回发送的条数
+    int replay(uint32_t afterSeq, void (*send)(uint8_t num, const char *s, size_t len), uint8_t num);
+    // 在快照 JSON 中插入当前的 seq 与 epoch，客户端据此续传；返回长度，放不下时返回 0
+    size_t stampSnapshot(char *dst, size_t cap, const char *json, size_t len);
+
+    uint32_t getLastSeq();
+    // 每次启动随机生成，用于识别设备重启（序号从 1 重新开始）
+    uint32_t getEpoch();
+    // 没有客户端在线时，未送达就被覆盖的非合并事件数（被新状态取代的旧状态不计入）
+    uint32_t getLost();
+}
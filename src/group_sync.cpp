@@ -0,0 +1,309 @@
+#include "group_sync.h"
+#include <Arduino.h>
+#include <WiFiUdp.h>
+#include <ArduinoJson.h>
+#include <esp_timer.h>
+#include "led_controller.h"
+#include "status_reporter.h"
+#include "storage.h"
+
+#ifndef GROUP_MULTICAST_ADDR
+#define GROUP_MULTICAST_ADDR 239, 77, 0, 1
+#endif
+#ifndef GROUP_PORT
+#define GROUP_PORT 4210
+#endif
+
+namespace GroupSync
+{
+    constexpr uint32_t MAGIC = 0x4744454C; // "LEDG"
+    constexpr uint8_t VERSION = 1;
+    // leader 的发送间隔；状态变化时立即额外发送一次
+    constexpr unsigned long BEACON_INTERVAL_MS = 250;
+    // 估计窗口：16 个信标约 4 s，期间晶振漂移（约 20 ppm）带来的误差远小于无线时延波动
+    constexpr int WINDOW = 16;
+    // 样本与当前估计相差超过该值时视为 leader 重启或更换，清空窗口重新估计
+    constexpr int64_t RESET_US = 1000000;
+    // 超过该时长未收到信标视为失步
+    constexpr unsigned long LOST_MS = 2000;
+
+    constexpr uint16_t FLAG_STATE = 0x0001; // 携带可应用的 LED 状态（stream 等模式下不携带）
+
+    // 报文为小端紧凑结构，共 28 字节
+    struct __attribute__((packed)) Packet
+    {
+        uint32_t magic;
+        uint8_t version;
+        uint8_t group;
+        uint16_t flags;
+        uint32_t seq;
+        int64_t leaderUs; // 发送时刻的组时钟
+        uint8_t mode;
+        uint8_t brightness;
+        uint16_t hz;
+        uint16_t periodMs;
+        uint16_t reserved;
+    };
+
+    static const char *const MODE_NAMES[] = {"off", "on", "blink", "breathe", "audio"};
+    constexpr int MODE_COUNT = sizeof(MODE_NAMES) / sizeof(MODE_NAMES[0]);
+
+    static WiFiUDP udp;
+    static Role role = ROLE_NONE;
+    static uint8_t group = 0;
+    static uint32_t seq = 0;
+    static unsigned long lastBeaconMs = 0;
+    static uint32_t sentVersion = 0;
+
+    // member 侧的偏移估计：sample = leader 发送时刻 - 本地接收时刻 = 偏移 - 单程时延。
+    // 时延非负，窗口内的最大样本对应时延最小的报文，作为偏移估计（最小时延滤波）
+    static int64_t window[WINDOW];
+    static int windowCount = 0;
+    static int windowIdx = 0;
+    static int64_t offsetUs = 0;
+    static uint32_t jitterUs = 0;
+    static uint32_t received = 0;
+    static uint32_t lost = 0;
+    static uint32_t lastSeq = 0;
+    static unsigned long lastRxMs = 0;
+
+    static void resetEstimator()
+    {
+        windowCount = 0;
+        windowIdx = 0;
+        offsetUs = 0;
+        jitterUs = 0;
+        received = 0;
+        lost = 0;
+    }
+
+    static void start(Role r, uint8_t g)
+    {
+        udp.stop();
+        role = r;
+        group = g;
+        resetEstimator();
+        LedController::setPhaseOffsetUs(0);
+        if (role != ROLE_NONE && !udp.beginMulticast(IPAddress(GROUP_MULTICAST_ADDR), GROUP_PORT))
+        {
+            Serial.println("GroupSync: multicast begin failed");
+            role = ROLE_NONE;
+        }
+        lastBeaconMs = 0;
+        sentVersion = LedController::getStateVersion() - 1;
+        StatusReporter::invalidate();
+    }
+
+    static int modeIndex(const char *mode)
+    {
+        for (int i = 0; i < MODE_COUNT; ++i)
+        {
+            if (strcmp(mode, MODE_NAMES[i]) == 0)
+                return i;
+        }
+        return -1;
+    }
+
+    static void sendBeacon()
+    {
+        Packet p = {};
+        p.magic = MAGIC;
+        p.version = VERSION;
+        p.group = group;
+        p.seq = ++seq;
+        int mode = modeIndex(LedController::getModeStr());
+        if (mode >= 0)
+        {
+            p.flags = FLAG_STATE;
+            p.mode = (uint8_t)mode;
+            p.brightness = LedController::getBrightness();
+            p.hz = (uint16_t)LedController::getBlinkHz();
+            p.periodMs = (uint16_t)LedController::getBreathePeriod();
+        }
+        // 时间戳尽量贴近实际发送时刻
+        p.leaderUs = esp_timer_get_time();
+        udp.beginMulticastPacket();
+        udp.write((const uint8_t *)&p, sizeof(p));
+        udp.endPacket();
+    }
+
+    static void updateEstimate(int64_t sample)
+    {
+        if (windowCount > 0 && (sample - offsetUs > RESET_US || offsetUs - sample > RESET_US))
+            resetEstimator();
+        window[windowIdx] = sample;
+        windowIdx = (windowIdx + 1) % WINDOW;
+        if (windowCount < WINDOW)
+            windowCount++;
+        int64_t hi = window[0], lo = window[0];
+        for (int i = 1; i < windowCount; ++i)
+        {
+            hi = max(hi, window[i]);
+            lo = min(lo, window[i]);
+        }
+        offsetUs = hi;
+        jitterUs = (uint32_t)(hi - lo);
+        LedController::setPhaseOffsetUs(offsetUs);
+    }
+
+    // 应用 leader 的状态：只在与本机不同时调用 setter，避免每个信标都触发状态版本变化
+    static void applyState(const Packet &p)
+    {
+        if (!(p.flags & FLAG_STATE) || p.mode >= MODE_COUNT || LedController::isStreaming())
+            return;
+        const char *mode = MODE_NAMES[p.mode];
+        bool changed = false;
+        if (strcmp(LedController::getModeStr(), mode) != 0 ||
+            (p.mode == 2 && LedController::getBlinkHz() != p.hz) ||
+            (p.mode == 3 && LedController::getBreathePeriod() != p.periodMs))
+        {
+            switch (p.mode)
+            {
+            case 0:
+                LedController::setModeOff();
+                break;
+            case 1:
+                LedController::setModeOn();
+                break;
+            case 2:
+                LedController::setModeBlink(max<int>(1, p.hz));
+                break;
+            case 3:
+                LedController::setModeBreathe(max<int>(200, p.periodMs));
+                break;
+            default:
+                LedController::setModeAudio();
+                break;
+            }
+            changed = true;
+        }
+        if (LedController::getBrightness() != p.brightness)
+        {
+            LedController::setBrightness(p.brightness);
+            changed = true;
+        }
+        if (changed)
+            StatusReporter::broadcast();
+    }
+
+    static void receive()
+    {
+        Packet p;
+        // 每次 loop 处理完所有已到达的报文，只保留最小时延的样本参与估计
+        while (udp.parsePacket() > 0)
+        {
+            int64_t localUs = esp_timer_get_time();
+            if (udp.read((uint8_t *)&p, sizeof(p)) != (int)sizeof(p))
+                continue;
+            if (p.magic != MAGIC || p.version != VERSION || p.group != group)
+                continue;
+            if (role != ROLE_MEMBER)
+                continue;
+            if (received > 0 && p.seq > lastSeq + 1)
+                lost += p.seq - lastSeq - 1;
+            lastSeq = p.seq;
+            received++;
+            lastRxMs = millis();
+            updateEstimate(p.leaderUs - localUs);
+            applyState(p);
+        }
+    }
+
+    void begin()
+    {
+        Role r = (Role)Storage::getSavedGroupRole();
+        if (r == ROLE_LEADER || r == ROLE_MEMBER)
+            start(r, Storage::getSavedGroup());
+    }
+
+    void loop()
+    {
+        if (role == ROLE_NONE)
+            return;
+        receive();
+        if (role == ROLE_LEADER)
+        {
+            unsigned long now = millis();
+            uint32_t version = LedController::getStateVersion();
+            if (version != sentVersion || now - lastBeaconMs >= BEACON_INTERVAL_MS)
+            {
+                sendBeacon();
+                sentVersion = version;
+                lastBeaconMs = now;
+            }
+        }
+    }
+
+    void lead(uint8_t g)
+    {
+        start(ROLE_LEADER, g);
+        Storage::saveState();
+    }
+
+    void join(uint8_t g)
+    {
+        start(ROLE_MEMBER, g);
+        Storage::saveState();
+    }
+
+    void leave()
+    {
+        start(ROLE_NONE, 0);
+        Storage::saveState();
+    }
+
+    Role getRole()
+    {
+        return role;
+    }
+
+    const char *getRoleStr()
+    {
+        switch (role)
+        {
+        case ROLE_LEADER:
+            return "leader";
+        case ROLE_MEMBER:
+            return "member";
+        default:
+            return "none";
+        }
+    }
+
+    uint8_t getGroup()
+    {
+        return group;
+    }
+
+    int64_t getOffsetUs()
+    {
+        return offsetUs;
+    }
+
+    uint32_t getJitterUs()
+    {
+        return jitterUs;
+    }
+
+    bool isSynced()
+    {
+        if (role == ROLE_LEADER)
+            return true;
+        return role == ROLE_MEMBER && windowCount > 0 && millis() - lastRxMs < LOST_MS;
+    }
+
+    size_t writeJson(char *buf, size_t cap)
+    {
+        StaticJsonDocument<256> doc;
+        doc["evt"] = "group";
+        doc["role"] = getRoleStr();
+        doc["group"] = group;
+        doc["synced"] = isSynced();
+        doc["offset_us"] = offsetUs;
+        doc["jitter_us"] = jitterUs;
+        doc["received"] = received;
+        doc["lost"] = lost;
+        doc["last_rx_ms"] = received ? (unsigned long)(millis() - lastRxMs) : 0;
+        return serializeJson(doc, buf, cap);
+    }
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// 组播群控：leader 周期性地以 UDP 组播发送自身 LED 状态与组时钟（leader 的 64 位微秒时钟），
+// member 应用该状态，并用估计出的时钟偏移对齐 LedController 的波形相位，使多台设备的 blink/breathe 同步
+namespace GroupSync
+{
+    enum Role : uint8_t
+    {
+        ROLE_NONE,
+        ROLE_LEADER,
+        ROLE_MEMBER
+    };
+
+    // 从 Storage 恢复角色与组号
+    void begin();
+    void loop();
+
+    void lead(uint8_t group);
+    void join(uint8_t group);
+    void leave();
+
+    Role getRole();
+    const char *getRoleStr();
+    uint8_t getGroup();
+    // 组时钟 - 本地时钟（us）的估计值；leader 恒为 0
+    int64_t getOffsetUs();
+    // 估计窗口内单程时延的波动（us），即相位误差的上界估计
+    uint32_t getJitterUs();
+    bool isSynced();
+
+    // evt 为 group 的状态 JSON
+    size_t writeJson(char *buf, size_t cap);
+}
@@ -1,6 +1,9 @@
 #include "led_controller.h"
 #include <Arduino.h>
 #include "storage.h"
+#include "metrics.h"
+#include "led_output.h"
+#include <esp_timer.h>
 #include <cstring>
 
 namespace LedController
@@ -11,14 +14,12 @@ namespace LedController
         MODE_ON,
         MODE_BLINK,
         MODE_BREATHE,
-        MODE_BREATHE_WAIT
+        MODE_AUDIO,
+        MODE_STREAM
     };
 
-    // 硬件配置
-    constexpr int LED_PIN = 12; // gpio12
-    constexpr int LEDC_CHANNEL = 0;
-    constexpr int LEDC_FREQ = 5000;  // base PWM frequency
-    constexpr int LEDC_RES_BITS = 8; // 8-bit resolution -> duty 0-255
+    // 输出后端与引脚在编译期通过 build_flags 选择（见 led_output.h）
+    using Output = LedOutput::Selected;
 
     static Mode currentMode = MODE_BREATHE;
     static int blinkHz = 2;
@@ -27,31 +28,192 @@ namespace LedController
 
     // 运行时状态
     static unsigned long lastMs = 0;
-    static unsigned long lastToggleMs = 0;
-    static bool blinkState = false;
-    // 用于在客户端断开连接时进入 breathe-wait 状态的保存变量
-    static Mode savedModeBeforeWait = MODE_BREATHE;
-    static int savedBlinkHzBeforeWait = 2;
-    static int savedBreathePeriodBeforeWait = 1500;
-    static uint8_t savedBrightnessBeforeWait = 128;
-    static bool hasSavedBeforeWait = false;
+    // 波形相位所用时钟相对本地时钟的偏移（us），群控 member 设为估计出的组时钟偏移
+    static int64_t phaseOffsetUs = 0;
+    // audio 模式下由 AudioInput 写入的电平（0-255），输出时再乘以亮度
+    static uint8_t audioLevel = 0;
+    // 覆盖层：基础层（当前模式的波形）之上按 Layer 顺序逐层合成；
+    // 临时效果只占用自己的层，不改动模式、周期与亮度等用户状态
+    struct LayerState
+    {
+        LayerSpec spec;
+        bool active;
+        unsigned long startMs;
+    };
+    static LayerState layers[LAYER_COUNT];
+    // 上一次写入输出后端的占空比，合成结果不变时不重复写外设
+    static int16_t lastDuty = -1;
+    // 流式播放的抖动缓冲：样本按发送端时间戳加固定延迟映射到本地时刻后排队，
+    // update 中按本地时钟取出到期样本，网络到达时间的抖动不会直接体现在 LED 上
+    struct StreamSample
+    {
+        uint32_t dueMs;
+        uint8_t duty;
+    };
+    constexpr size_t STREAM_CAPACITY = 64;
+    static StreamSample streamBuf[STREAM_CAPACITY];
+    static size_t streamHead = 0;
+    static size_t streamCount = 0;
+    static uint16_t streamDelayMs = 0;
+    static bool streamSynced = false;
+    static uint32_t streamOffset = 0; // 本地时刻 = 发送端时间戳 + streamOffset
+    static uint32_t streamLastDue = 0;
+    static Mode streamPrevMode = MODE_BREATHE;
+    static uint8_t streamDuty = 0; // 最近播放的样本，没有新样本到期时保持
+    static StreamStats streamStats;
+    // 亮度渐变：update 中按经过时间线性插值，结束时才递增 stateVersion
+    static uint8_t fadeFrom = 0;
+    static uint8_t fadeTarget = 0;
+    static unsigned long fadeStartMs = 0;
+    static uint32_t fadeMs = 0;
+    // 状态版本号：任何对外可见的状态变化都会递增，StatusReporter 据此判断快照是否过期
+    static uint32_t stateVersion = 0;
+
+    // sin²(πi/128)，i = 0..64，Q16；即升余弦 (1 - cos 2πx) / 2 在半个周期上的取值
+    static const uint16_t RAISED_COS_Q16[65] = {
+        0, 39, 158, 355, 630, 982, 1411, 1915,
+        2494, 3146, 3869, 4662, 5522, 6448, 7438, 8488,
+        9597, 10762, 11980, 13248, 14563, 15922, 17321, 18758,
+        20228, 21728, 23256, 24806, 26375, 27960, 29556, 31160,
+        32767, 34375, 35979, 37575, 39160, 40729, 42279, 43807,
+        45307, 46777, 48214, 49613, 50972, 52287, 53555, 54773,
+        55938, 57047, 58097, 59087, 60013, 60873, 61666, 62389,
+        63041, 63620, 64124, 64553, 64905, 65180, 65377, 65496,
+        65535};
+
+    // 平滑呼吸曲线：phase 为 Q16 的周期相位（0..65535 对应 [0, 1)），返回 level × 曲线值（0..level）
+    static inline uint8_t raisedCos(uint32_t phase, uint8_t level)
+    {
+        // 曲线关于半周期对称，折叠后查表并线性插值
+        if (phase >= 32768)
+            phase = 65536 - phase;
+        uint32_t idx = phase >> 9;
+        uint32_t frac = phase & 511;
+        uint32_t v = RAISED_COS_Q16[idx];
+        if (idx < 64)
+            v += ((RAISED_COS_Q16[idx + 1] - v) * frac) >> 9;
+        return (uint8_t)((v * level) >> 16);
+    }
+
+    static inline uint32_t phaseQ16(uint64_t t, uint32_t periodMs)
+    {
+        return (uint32_t)((t % periodMs) * 65536u / periodMs);
+    }
+
+    // Q8 乘法：level 255 视为 1.0
+    static inline uint8_t mulQ8(uint8_t a, uint8_t b)
+    {
+        return (uint8_t)(((uint16_t)a * (uint16_t)(b + 1)) >> 8);
+    }
+
+    static inline uint8_t blend(Blend mode, uint8_t dst, uint8_t src)
+    {
+        switch (mode)
+        {
+        case BLEND_MAX:
+            return dst > src ? dst : src;
+        case BLEND_MULTIPLY:
+            return mulQ8(dst, src);
+        default:
+            return src;
+        }
+    }
+
+    // 基础层：按当前模式计算占空比；effectMs 为（对齐到组时钟的）波形相位时钟
+    static uint8_t baseDuty(unsigned long now, uint64_t effectMs)
+    {
+        switch (currentMode)
+        {
+        case MODE_ON:
+            return brightness;
+        case MODE_BLINK:
+        {
+            if (blinkHz <= 0)
+                return 0;
+            unsigned long period = 1000u / (unsigned long)blinkHz; // 计算周期（ms）
+            if (period == 0)
+                period = 1;
+            // 亮灭由相位决定而不是由上次翻转时刻累加，多台设备只要时钟对齐就会同时翻转
+            return (effectMs % period) < period / 2 ? brightness : 0;
+        }
+        case MODE_BREATHE:
+            if (breathePeriod <= 0)
+                return 0;
+            return raisedCos(phaseQ16(effectMs, (uint32_t)breathePeriod), brightness);
+        case MODE_AUDIO:
+            return mulQ8(audioLevel, brightness);
+        case MODE_STREAM:
+        {
+            // 取出全部到期样本，只保留最新的一个；没有到期样本时保持上一输出
+            bool played = false;
+            while (streamCount > 0 && (int32_t)(streamBuf[streamHead].dueMs - (uint32_t)now) <= 0)
+            {
+                streamDuty = streamBuf[streamHead].duty;
+                streamHead = (streamHead + 1) % STREAM_CAPACITY;
+                streamCount--;
+                streamStats.played++;
+                played = true;
+            }
+            if (played && streamCount == 0)
+            {
+                // 缓冲被取空：下一帧若未按时到达，输出就会停顿
+                streamStats.underruns++;
+                Metrics::inc(Metrics::CNT_STREAM_UNDERRUNS);
+            }
+            return streamDuty;
+        }
+        case MODE_OFF:
+        default:
+            return 0;
+        }
+    }
 
-    // 实际写入 PWM 占空比的助手函数
-    static void applyDuty(uint8_t duty)
+    // 覆盖层的取值；相位从层启用时刻算起
+    static uint8_t layerDuty(const LayerState &l, unsigned long now)
     {
-        // ledcWrite 在已配置 ledcSetup 时期望 0..(2^bits-1) 的值
-        ledcWrite(LEDC_CHANNEL, duty);
+        const LayerSpec &s = l.spec;
+        if (s.effect == EFFECT_SOLID || s.periodMs == 0)
+            return s.level;
+        unsigned long t = now - l.startMs;
+        if (s.effect == EFFECT_FLASH)
+            return (t % s.periodMs) < s.periodMs / 2u ? s.level : 0;
+        return raisedCos(phaseQ16(t, s.periodMs), s.level);
+    }
+
+    // 一次遍历完成合成：基础层，再按 Layer 顺序叠加各覆盖层（顺带淘汰到期的层），
+    // 结果写入输出后端 Out；模板参数在编译期确定，写入直接内联到具体外设
+    template <typename Out>
+    static void render(unsigned long now, uint64_t effectMs)
+    {
+        uint8_t duty = baseDuty(now, effectMs);
+        for (int i = 0; i < LAYER_COUNT; ++i)
+        {
+            LayerState &l = layers[i];
+            if (!l.active)
+                continue;
+            if (l.spec.ttlMs && now - l.startMs >= l.spec.ttlMs)
+            {
+                l.active = false;
+                stateVersion++;
+                continue;
+            }
+            duty = blend(l.spec.blend, duty, layerDuty(l, now));
+        }
+        if (duty != lastDuty)
+        {
+            lastDuty = duty;
+            Out::write(duty);
+        }
     }
 
     void begin()
     {
-    // 配置 LEDC 用于 gpio12
-        ledcSetup(LEDC_CHANNEL, LEDC_FREQ, LEDC_RES_BITS);
-        ledcAttachPin(LED_PIN, LEDC_CHANNEL);
+    // 初始化输出外设
+        Output::begin();
     // 初始化计时器
         lastMs = millis();
-        lastToggleMs = lastMs;
-        blinkState = false;
+        lastDuty = -1;
+        memset(layers, 0, sizeof(layers));
 
     // 从 Storage 中应用保存的状态（如果有）。保证重启后恢复闪烁频率与呼吸周期。
         const char *m = Storage::getSavedMode();
@@ -67,6 +229,10 @@ namespace LedController
         {
             setModeBlink(Storage::getSavedBlinkHz());
         }
+        else if (m && strcmp(m, "audio") == 0)
+        {
+            setModeAudio();
+        }
         else
         {
             setModeBreathe(Storage::getSavedBreathePeriod());
@@ -82,134 +248,216 @@ namespace LedController
         unsigned long dt = now - lastMs;
         lastMs = now;
 
-        switch (currentMode)
+        if (fadeMs > 0)
         {
-        case MODE_ON:
-            applyDuty(brightness);
-            break;
-        case MODE_OFF:
-            applyDuty(0);
-            break;
-        case MODE_BLINK:
-        {
-            if (blinkHz <= 0)
+            unsigned long elapsed = now - fadeStartMs;
+            if (elapsed >= fadeMs)
             {
-                applyDuty(0);
-                break;
+                brightness = fadeTarget;
+                fadeMs = 0;
+                stateVersion++;
             }
-            unsigned long period = 1000u / (unsigned long)blinkHz; // 计算周期（ms）
-            unsigned long half = period / 2;
-            if (now - lastToggleMs >= half)
-            {
-                lastToggleMs = now;
-                blinkState = !blinkState;
-                applyDuty(blinkState ? brightness : 0);
-            }
-            break;
-        }
-        case MODE_BREATHE:
-        case MODE_BREATHE_WAIT:
-        {
-            // 计算相位 [0..1)
-            if (breathePeriod <= 0)
+            else
             {
-                applyDuty(0);
-                break;
+                brightness = (uint8_t)(fadeFrom + ((int32_t)fadeTarget - (int32_t)fadeFrom) * (int32_t)elapsed / (int32_t)fadeMs);
             }
-            float phase = fmod((float)now, (float)breathePeriod) / (float)breathePeriod; // 0..1
-            // 使用 (1 - cos(2*pi*phase))/2 来实现平滑呼吸曲线
-            float val = (1.0f - cosf(2.0f * 3.14159265f * phase)) * 0.5f;
-            // 应用亮度缩放
-            if (currentMode == MODE_BREATHE_WAIT)
-                val *= 0.6f;
-            uint8_t duty = (uint8_t)constrain((int)(val * (float)brightness), 0, 255);
-            applyDuty(duty);
-            break;
-        }
         }
+
+        render<Output>(now, (uint64_t)(esp_timer_get_time() + phaseOffsetUs) / 1000u);
+    }
+
+    void setPhaseOffsetUs(int64_t offsetUs)
+    {
+        phaseOffsetUs = offsetUs;
     }
 
     void setModeOn()
     {
         currentMode = MODE_ON;
+        stateVersion++;
     }
 
     void setModeOff()
     {
         currentMode = MODE_OFF;
+        stateVersion++;
     }
 
     void setModeBlink(int hz)
     {
         blinkHz = hz;
         currentMode = MODE_BLINK;
+        stateVersion++;
     }
 
     void setModeBreathe(int period_ms)
     {
         breathePeriod = period_ms;
         currentMode = MODE_BREATHE;
+        stateVersion++;
+    }
+
+    void setModeAudio()
+    {
+        audioLevel = 0;
+        currentMode = MODE_AUDIO;
+        stateVersion++;
+    }
+
+    void setAudioLevel(uint8_t level)
+    {
+        // 电平是高频变化的瞬时值，不属于对外状态，不递增 stateVersion
+        audioLevel = level;
+    }
+
+    void streamBegin(uint16_t delayMs)
+    {
+        if (currentMode != MODE_STREAM)
+            streamPrevMode = currentMode;
+        streamHead = 0;
+        streamCount = 0;
+        // 第一个样本到期前保持当前输出
+        streamDuty = lastDuty >= 0 ? (uint8_t)lastDuty : 0;
+        streamDelayMs = delayMs;
+        streamSynced = false;
+        memset(&streamStats, 0, sizeof(streamStats));
+        currentMode = MODE_STREAM;
+        stateVersion++;
+    }
+
+    void streamEnd()
+    {
+        if (currentMode != MODE_STREAM)
+            return;
+        currentMode = streamPrevMode;
+        streamCount = 0;
+        stateVersion++;
+    }
+
+    bool isStreaming()
+    {
+        return currentMode == MODE_STREAM;
+    }
+
+    void streamPush(uint32_t tMs, uint8_t duty)
+    {
+        if (currentMode != MODE_STREAM)
+            return;
+        streamStats.received++;
+        uint32_t now = millis();
+        // 第一个样本确定发送端时钟到本地时钟的映射，之后保持不变
+        if (!streamSynced)
+        {
+            streamOffset = now + streamDelayMs - tMs;
+            streamSynced = true;
+        }
+        uint32_t due = tMs + streamOffset;
+        // 已过播放时刻或时间戳回退的样本直接丢弃
+        if ((int32_t)(due - now) < 0 || (streamCount > 0 && (int32_t)(due - streamLastDue) <= 0))
+        {
+            streamStats.late++;
+            Metrics::inc(Metrics::CNT_STREAM_LATE);
+            return;
+        }
+        if (streamCount == STREAM_CAPACITY)
+        {
+            // 缓冲已满：丢弃最旧的样本
+            streamHead = (streamHead + 1) % STREAM_CAPACITY;
+            streamCount--;
+            streamStats.overruns++;
+            Metrics::inc(Metrics::CNT_STREAM_OVERRUNS);
+        }
+        streamBuf[(streamHead + streamCount) % STREAM_CAPACITY] = {due, duty};
+        streamCount++;
+        streamLastDue = due;
+    }
+
+    const StreamStats &getStreamStats()
+    {
+        streamStats.depth = (uint16_t)streamCount;
+        return streamStats;
+    }
+
+    void fadeBrightness(uint8_t duty, uint32_t ms)
+    {
+        fadeFrom = brightness;
+        fadeTarget = duty;
+        fadeStartMs = millis();
+        fadeMs = ms;
+        stateVersion++;
     }
 
     void setBrightness(uint8_t duty)
     {
+        // 输出在下一次 update 中按合成结果写入
+        fadeMs = 0;
         brightness = duty;
-        if (currentMode == MODE_ON)
-            applyDuty(brightness);
-        else if (currentMode == MODE_BLINK && blinkState)
-            applyDuty(brightness);
+        stateVersion++;
     }
 
-    void onClientConnected()
+    void setLayer(Layer layer, const LayerSpec &spec)
     {
-        // 取消任何 breathe-wait 状态，并在有保存的前置状态时恢复它
-        if (currentMode == MODE_BREATHE_WAIT)
+        if (layer >= LAYER_COUNT)
+            return;
+        layers[layer].spec = spec;
+        layers[layer].active = true;
+        layers[layer].startMs = millis();
+        stateVersion++;
+    }
+
+    void clearLayer(Layer layer)
+    {
+        if (layer >= LAYER_COUNT || !layers[layer].active)
+            return;
+        layers[layer].active = false;
+        stateVersion++;
+    }
+
+    bool isLayerActive(Layer layer)
+    {
+        return layer < LAYER_COUNT && layers[layer].active;
+    }
+
+    uint8_t getActiveLayers()
+    {
+        uint8_t mask = 0;
+        for (int i = 0; i < LAYER_COUNT; ++i)
         {
-            if (hasSavedBeforeWait)
-            {
-                // 恢复之前保存的参数
-                setBrightness(savedBrightnessBeforeWait);
-                switch (savedModeBeforeWait)
-                {
-                case MODE_ON:
-                    setModeOn();
-                    break;
-                case MODE_OFF:
-                    setModeOff();
-                    break;
-                case MODE_BLINK:
-                    setModeBlink(savedBlinkHzBeforeWait);
-                    break;
-                case MODE_BREATHE:
-                default:
-                    setModeBreathe(savedBreathePeriodBeforeWait);
-                    break;
-                }
-                hasSavedBeforeWait = false;
-            }
-            else
-            {
-                // 未保存前置状态：回到普通呼吸模式
-                currentMode = MODE_BREATHE;
-            }
+            if (layers[i].active)
+                mask |= 1u << i;
         }
+        return mask;
+    }
+
+    void notify(uint8_t level, uint16_t periodMs, uint32_t ttlMs)
+    {
+        // 叠加在当前输出之上闪烁（取较大值），到期后自动移除
+        setLayer(LAYER_NOTIFY, LayerSpec{EFFECT_FLASH, BLEND_MAX, level, periodMs, ttlMs});
+    }
+
+    void setLimit(uint8_t level)
+    {
+        if (level == 255)
+            clearLayer(LAYER_LIMIT);
+        else
+            setLayer(LAYER_LIMIT, LayerSpec{EFFECT_SOLID, BLEND_MULTIPLY, level, 0, 0});
+    }
+
+    uint8_t getLimit()
+    {
+        return layers[LAYER_LIMIT].active ? layers[LAYER_LIMIT].spec.level : 255;
+    }
+
+    void onClientConnected()
+    {
+        // 移除空闲效果层，下面的用户状态本来就没有被改动
+        clearLayer(LAYER_IDLE);
     }
 
     void enterBreatheWait()
     {
-        // 进入 breathe-wait 前保存当前运行状态，以便在客户端重新连接时恢复
-        if (!hasSavedBeforeWait && currentMode != MODE_BREATHE_WAIT)
-        {
-            savedModeBeforeWait = currentMode;
-            savedBlinkHzBeforeWait = blinkHz;
-            savedBreathePeriodBeforeWait = breathePeriod;
-            savedBrightnessBeforeWait = brightness;
-            hasSavedBeforeWait = true;
-        }
-        currentMode = MODE_BREATHE_WAIT;
-        // 在等待模式下使用较快的小幅呼吸作为空闲视觉效果
-        breathePeriod = 800;
-        brightness = 255;
+        // 空闲视觉效果：较快的小幅呼吸（峰值约 60%），覆盖基础层
+        setLayer(LAYER_IDLE, LayerSpec{EFFECT_PULSE, BLEND_OVERRIDE, 153, 800, 0});
     }
 
     const char *getModeStr()
@@ -222,8 +470,11 @@ namespace LedController
             return "off";
         case MODE_BLINK:
             return "blink";
+        case MODE_AUDIO:
+            return "audio";
+        case MODE_STREAM:
+            return "stream";
         case MODE_BREATHE:
-        case MODE_BREATHE_WAIT:
         default:
             return "breathe";
         }
@@ -241,6 +492,12 @@ namespace LedController
 
     uint8_t getBrightness()
     {
-        return brightness;
+        // 渐变过程中返回目标值：状态上报与持久化都以设定值为准
+        return fadeMs > 0 ? fadeTarget : brightness;
+    }
+
+    uint32_t getStateVersion()
+    {
+        return stateVersion;
     }
 }
@@ -3,18 +3,86 @@
 
 namespace LedController
 {
+    struct StreamStats
+    {
+        uint32_t received;
+        uint32_t played;
+        uint32_t underruns; // 播放时缓冲被取空的次数
+        uint32_t overruns;  // 缓冲满时丢弃最旧样本的次数
+        uint32_t late;      // 到达时已过播放时刻而丢弃的样本数
+        uint16_t depth;     // 当前缓冲中的样本数
+    };
+
+    // 覆盖层与下方结果的合成方式（Q8 定点，255 视为 1.0）
+    enum Blend : uint8_t
+    {
+        BLEND_MAX,      // 取较大值
+        BLEND_MULTIPLY, // 按层的取值缩放
+        BLEND_OVERRIDE  // 替换
+    };
+
+    enum Effect : uint8_t
+    {
+        EFFECT_SOLID, // 恒定 level
+        EFFECT_PULSE, // 0..level 的平滑呼吸，周期 periodMs
+        EFFECT_FLASH  // 0 / level 方波，周期 periodMs
+    };
+
+    // 覆盖层，按此顺序依次合成在基础层（当前模式的波形）之上，后合成的位于上方
+    enum Layer : uint8_t
+    {
+        LAYER_IDLE,   // 无客户端时的空闲呼吸（breathe-wait）
+        LAYER_NOTIFY, // 通知闪烁
+        LAYER_LIMIT,  // 亮度上限（缩放最终输出）
+        LAYER_COUNT
+    };
+
+    struct LayerSpec
+    {
+        Effect effect;
+        Blend blend;
+        uint8_t level;
+        uint16_t periodMs;
+        uint32_t ttlMs; // 启用后经过该时长自动移除；0 表示一直保持
+    };
+
     void begin();
     void update();
+    // blink/breathe 的相位按 esp_timer 时钟 + offsetUs 计算；群控时设为组时钟偏移，使多台设备波形同相
+    void setPhaseOffsetUs(int64_t offsetUs);
     void setModeOn();
     void setModeOff();
     void setModeBlink(int hz);
     void setModeBreathe(int period_ms);
+    // audio 模式：输出由 AudioInput 提供的电平，再按亮度缩放
+    void setModeAudio();
+    void setAudioLevel(uint8_t level);
+    // stream 模式：按 (时间戳, 占空比) 样本经抖动缓冲在固定延迟后播放，结束时恢复之前的模式
+    void streamBegin(uint16_t delayMs);
+    void streamEnd();
+    bool isStreaming();
+    void streamPush(uint32_t tMs, uint8_t duty);
+    const StreamStats &getStreamStats();
     void setBrightness(uint8_t duty);
+    // 在 ms 毫秒内把亮度线性过渡到 duty；setBrightness 会取消进行中的渐变
+    void fadeBrightness(uint8_t duty, uint32_t ms);
+    // 覆盖层只影响输出，不改动模式、参数与亮度（状态上报与持久化仍是用户设定的值）
+    void setLayer(Layer layer, const LayerSpec &spec);
+    void clearLayer(Layer layer);
+    bool isLayerActive(Layer layer);
+    // 按 Layer 编号的位掩码
+    uint8_t getActiveLayers();
+    void notify(uint8_t level, uint16_t periodMs, uint32_t ttlMs);
+    // 255 表示不限制
+    void setLimit(uint8_t level);
+    uint8_t getLimit();
+    // 客户端连接/全部断开时移除/启用空闲效果层
     void onClientConnected();
     void enterBreatheWait();
-    // 用于在客户端断开连接时进入 breathe-wait 状态的保存变量
     const char *getModeStr();
     int getBlinkHz();
     int getBreathePeriod();
     uint8_t getBrightness();
+    // 每次模式/参数变化递增，用于判断缓存的状态快照是否过期
+    uint32_t getStateVersion();
 }
@@ -0,0 +1,190 @@
+#pragma once
+#include <Arduino.h>
+
+// LED 输出后端：每个后端是只含静态内联函数的策略类型（begin / write），
+// LedController 以模板参数使用，编译期绑定，热路径内联到具体的外设写入，没有虚函数或函数指针
+//
+// 通过 build_flags 选择后端与引脚（未定义时使用默认值），例如：
+//   -DLED_OUTPUT=LED_OUTPUT_RMT_PIXEL -DLED_PIN=8
+#define LED_OUTPUT_LEDC 1        // LEDC PWM（默认）
+#define LED_OUTPUT_SIGMA_DELTA 2 // sigma-delta 调制输出，适合外接 RC 滤波得到模拟电压
+#define LED_OUTPUT_GPIO 3        // 普通 GPIO 开/关，占空比按阈值二值化
+#define LED_OUTPUT_RMT_PIXEL 4   // RMT 驱动的 WS2812 灯珠（整串同色白光）
+#define LED_OUTPUT_RECORDER 5    // 主机测试用：只记录占空比变化，不访问硬件
+
+#ifndef LED_OUTPUT
+#define LED_OUTPUT LED_OUTPUT_LEDC
+#endif
+#ifndef LED_PIN
+#define LED_PIN 12
+#endif
+#ifndef LED_LEDC_CHANNEL
+#define LED_LEDC_CHANNEL 0
+#endif
+#ifndef LED_PWM_FREQ
+#define LED_PWM_FREQ 5000
+#endif
+#ifndef LED_PWM_RES_BITS
+#define LED_PWM_RES_BITS 8
+#endif
+#ifndef LED_SD_CHANNEL
+#define LED_SD_CHANNEL 0
+#endif
+#ifndef LED_SD_FREQ
+#define LED_SD_FREQ 312500
+#endif
+#ifndef LED_GPIO_THRESHOLD
+#define LED_GPIO_THRESHOLD 128
+#endif
+#ifndef LED_PIXEL_COUNT
+#define LED_PIXEL_COUNT 1
+#endif
+
+namespace LedOutput
+{
+    struct Ledc
+    {
+        static constexpr uint32_t MAX_DUTY = (1u << LED_PWM_RES_BITS) - 1;
+
+        static void begin()
+        {
+            ledcSetup(LED_LEDC_CHANNEL, LED_PWM_FREQ, LED_PWM_RES_BITS);
+            ledcAttachPin(LED_PIN, LED_LEDC_CHANNEL);
+        }
+
+        static inline void write(uint8_t duty)
+        {
+            // 0..255 映射到 0..(2^bits-1)；8 位分辨率时编译器会消去乘除
+            ledcWrite(LED_LEDC_CHANNEL, (uint32_t)duty * MAX_DUTY / 255u);
+        }
+    };
+
+    struct SigmaDelta
+    {
+        static void begin()
+        {
+            sigmaDeltaSetup(LED_PIN, LED_SD_CHANNEL, LED_SD_FREQ);
+        }
+
+        static inline void write(uint8_t duty)
+        {
+            sigmaDeltaWrite(LED_SD_CHANNEL, duty);
+        }
+    };
+
+    struct Gpio
+    {
+        static inline int8_t last = -1;
+
+        static void begin()
+        {
+            pinMode(LED_PIN, OUTPUT);
+            last = -1;
+        }
+
+        static inline void write(uint8_t duty)
+        {
+            int8_t level = duty >= LED_GPIO_THRESHOLD ? HIGH : LOW;
+            if (level == last)
+                return;
+            last = level;
+            digitalWrite(LED_PIN, level);
+        }
+    };
+
+    struct RmtPixel
+    {
+        // tick 100ns：0 码高 0.4us / 低 0.85us，1 码高 0.8us / 低 0.45us
+        static constexpr uint32_t T0H = 4, T0L = 8, T1H = 8, T1L = 4;
+        static constexpr size_t BITS = 24 * LED_PIXEL_COUNT;
+
+        static inline rmt_obj_t *rmt = nullptr;
+        static inline rmt_data_t frame[BITS];
+        static inline int16_t last = -1;
+
+        static void begin()
+        {
+            rmt = rmtInit(LED_PIN, RMT_TX_MODE, RMT_MEM_64);
+            if (rmt)
+                rmtSetTick(rmt, 100);
+            last = -1;
+        }
+
+        static inline void write(uint8_t duty)
+        {
+            // 每帧要重新编码并发送整串灯珠，只在占空比变化时发送
+            if (duty == last || !rmt)
+                return;
+            last = duty;
+            for (size_t i = 0; i < BITS; ++i)
+            {
+                // GRB 三个通道取同一值，高位在前
+                bool one = (duty >> (7 - (i & 7))) & 1;
+                frame[i].level0 = 1;
+                frame[i].duration0 = one ? T1H : T0H;
+                frame[i].level1 = 0;
+                frame[i].duration1 = one ? T1L : T0L;
+            }
+            rmtWrite(rmt, frame, BITS);
+        }
+    };
+
+    struct Recorder
+    {
+        struct Sample
+        {
+            uint32_t tUs;
+            uint8_t duty;
+        };
+        static constexpr size_t CAPACITY = 1024;
+
+        static inline Sample ring[CAPACITY];
+        static inline size_t head = 0;
+        static inline size_t count = 0;
+        static inline uint32_t writes = 0;
+
+        static void begin()
+        {
+            clear();
+        }
+
+        static inline void write(uint8_t duty)
+        {
+            writes++;
+            // 只记录变化点，满时覆盖最旧的记录
+            if (count > 0 && at(count - 1).duty == duty)
+                return;
+            ring[(head + count) % CAPACITY] = {(uint32_t)micros(), duty};
+            if (count < CAPACITY)
+                count++;
+            else
+                head = (head + 1) % CAPACITY;
+        }
+
+        static void clear()
+        {
+            head = 0;
+            count = 0;
+            writes = 0;
+        }
+
+        static size_t size() { return count; }
+        static const Sample &at(size_t i) { return ring[(head + i) % CAPACITY]; }
+        static uint8_t last() { return count ? at(count - 1).duty : 0; }
+        static uint32_t writeCount() { return writes; }
+    };
+
+#if LED_OUTPUT == LED_OUTPUT_LEDC
+    using Selected = Ledc;
+#elif LED_OUTPUT == LED_OUTPUT_SIGMA_DELTA
+    using Selected = SigmaDelta;
+#elif LED_OUTPUT == LED_OUTPUT_GPIO
+    using Selected = Gpio;
+#elif LED_OUTPUT == LED_OUTPUT_RMT_PIXEL
+    using Selected = RmtPixel;
+#elif LED_OUTPUT == LED_OUTPUT_RECORDER
+    using Selected = Recorder;
+#else
+#error "unknown LED_OUTPUT"
+#endif
+}
@@ -0,0 +1,178 @@
+#include "log.h"
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <atomic>
+
+namespace Log
+{
+    // 空闲时每次最多输出的条数与轮询间隔
+    constexpr size_t DRAIN_BATCH = 16;
+    constexpr uint32_t DRAIN_POLL_MS = 20;
+
+    static Record ring[CAPACITY];
+    // 已写入的记录总数：只由 loop 任务递增，排空任务只读；下标为 head % CAPACITY
+    static std::atomic<uint32_t> head{0};
+    // 排空任务已输出到的位置（只由排空任务访问）
+    static uint32_t drained = 0;
+    static std::atomic<uint32_t> dropped{0};
+    static uint8_t levels[MOD_COUNT];
+    static unsigned long startUs = 0;
+
+    static const char *const LEVEL_NAMES[] = {"error", "warn", "info", "debug"};
+
+    static void drainTask(void *)
+    {
+        for (;;)
+        {
+            if (drain(DRAIN_BATCH) < DRAIN_BATCH)
+                vTaskDelay(pdMS_TO_TICKS(DRAIN_POLL_MS));
+        }
+    }
+
+    void begin()
+    {
+        for (size_t i = 0; i < MOD_COUNT; ++i)
+            levels[i] = LVL_INFO;
+        startUs = micros();
+        // 空闲优先级（0）：只在 loop 任务阻塞（delay / 等待网络）时运行，串口发送不再占用 loop 的时间
+        xTaskCreate(drainTask, "log_drain", 3072, nullptr, tskIDLE_PRIORITY, nullptr);
+    }
+
+    void record(Id id, uint8_t argc, const int32_t *args)
+    {
+        if (id >= ID_COUNT || FORMATS[id].level > levels[FORMATS[id].module])
+            return;
+        uint32_t h = head.load(std::memory_order_relaxed);
+        Record &r = ring[h % CAPACITY];
+        r.tUs = (uint32_t)(micros() - startUs);
+        r.id = id;
+        r.argc = argc;
+        r.reserved = 0;
+        memcpy(r.args, args, sizeof(r.args));
+        // 先写完记录再发布，排空任务看到新的 head 时记录内容已完整
+        head.store(h + 1, std::memory_order_release);
+    }
+
+    size_t format(const Record &r, char *buf, size_t cap)
+    {
+        if (r.id >= ID_COUNT)
+            return snprintf(buf, cap, "[%10.3f] ? unknown log id %u", r.tUs / 1000.0, r.id);
+        const Format &f = FORMATS[r.id];
+        int n = snprintf(buf, cap, "[%10.3f] %s: ", r.tUs / 1000.0, MODULE_NAMES[f.module]);
+        if (n < 0 || (size_t)n >= cap)
+            return cap ? cap - 1 : 0;
+        // 多余的参数不会被格式串引用
+        int m = snprintf(buf + n, cap - n, f.fmt, r.args[0], r.args[1], r.args[2], r.args[3]);
+        return m < 0 ? n : min(cap - 1, (size_t)(n + m));
+    }
+
+    size_t drain(size_t maxRecords)
+    {
+        size_t done = 0;
+        char line[160];
+        while (done < maxRecords)
+        {
+            uint32_t h = head.load(std::memory_order_acquire);
+            if (drained == h)
+                break;
+            // 生产者已绕过一整圈：未输出的旧记录已被覆盖（或正在被覆盖）
+            if (h - drained >= CAPACITY)
+            {
+                uint32_t skip = h - drained - CAPACITY + 1;
+                dropped.fetch_add(skip, std::memory_order_relaxed);
+                drained += skip;
+            }
+            Record r = ring[drained % CAPACITY];
+            // 复制期间被覆盖则丢弃这条
+            if (head.load(std::memory_order_acquire) - drained >= CAPACITY)
+            {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                drained++;
+                continue;
+            }
+            drained++;
+            size_t len = format(r, line, sizeof(line) - 1);
+            line[len++] = '\n';
+            Serial.write((const uint8_t *)line, len);
+            done++;
+        }
+        return done;
+    }
+
+    bool setLevel(const char *module, const char *level)
+    {
+        int lvl = -1;
+        for (int i = 0; i < 4; ++i)
+        {
+            if (strcmp(level, LEVEL_NAMES[i]) == 0)
+                lvl = i;
+        }
+        if (lvl < 0)
+            return false;
+        bool all = strcmp(module, "all") == 0;
+        bool found = false;
+        for (size_t i = 0; i < MOD_COUNT; ++i)
+        {
+            if (all || strcmp(module, MODULE_NAMES[i]) == 0)
+            {
+                levels[i] = (uint8_t)lvl;
+                found = true;
+            }
+        }
+        return found;
+    }
+
+    const char *getLevelStr(Level level)
+    {
+        return level <= LVL_DEBUG ? LEVEL_NAMES[level] : "?";
+    }
+
+    uint32_t getWritten()
+    {
+        return head.load(std::memory_order_relaxed);
+    }
+
+    uint32_t getDropped()
+    {
+        return dropped.load(std::memory_order_relaxed);
+    }
+
+    void fillFileHeader(FileHeader &h)
+    {
+        uint32_t written = head.load(std::memory_order_relaxed);
+        h.magic = FILE_MAGIC;
+        h.version = FILE_VERSION;
+        h.recordSize = sizeof(Record);
+        h.count = min<uint32_t>(written, CAPACITY);
+        h.evicted = written - h.count;
+        h.formatHash = formatHash();
+    }
+
+    void getSegments(const uint8_t **a, size_t *alen, const uint8_t **b, size_t *blen)
+    {
+        // 与 record 同在 loop 任务中调用，期间环形缓冲不会变化
+        uint32_t written = head.load(std::memory_order_relaxed);
+        uint32_t count = min<uint32_t>(written, CAPACITY);
+        size_t first = (written - count) % CAPACITY;
+        size_t firstCount = min<size_t>(count, CAPACITY - first);
+        *a = (const uint8_t *)&ring[first];
+        *alen = firstCount * sizeof(Record);
+        *b = (const uint8_t *)&ring[0];
+        *blen = (count - firstCount) * sizeof(Record);
+    }
+
+    size_t writeJson(char *buf, size_t cap)
+    {
+        StaticJsonDocument<256> doc;
+        doc["evt"] = "log";
+        JsonObject lv = doc.createNestedObject("levels");
+        for (size_t i = 0; i < MOD_COUNT; ++i)
+            lv[MODULE_NAMES[i]] = getLevelStr((Level)levels[i]);
+        doc["written"] = getWritten();
+        doc["dropped"] = getDropped();
+        doc["capacity"] = CAPACITY;
+        return serializeJson(doc, buf, cap);
+    }
+}
@@ -0,0 +1,125 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include "log_formats.h"
+
+// 延迟格式化的二进制日志：调用处只把格式 id 与整数参数写入 RAM 环形缓冲（约 1 us），
+// 由空闲优先级任务在 loop 阻塞时格式化并输出到串口，不再在 loop 中同步等待 115200 波特率的串口发送。
+// 缓冲保留最近的记录，可通过 HTTP /log 下载，用 program logdecode 还原为文本
+namespace Log
+{
+    constexpr uint32_t FILE_MAGIC = 0x474F4C53; // "SLOG"（小端）
+    constexpr uint16_t FILE_VERSION = 1;
+    constexpr size_t CAPACITY = 256;
+    constexpr int MAX_ARGS = 4;
+
+    enum Level : uint8_t
+    {
+        LVL_ERROR,
+        LVL_WARN,
+        LVL_INFO,
+        LVL_DEBUG
+    };
+
+    enum Module : uint8_t
+    {
+#define LOG_X_MODULE(name, str) MOD_##name,
+        LOG_MODULES(LOG_X_MODULE)
+#undef LOG_X_MODULE
+            MOD_COUNT
+    };
+
+    enum Id : uint16_t
+    {
+#define LOG_X_ID(id, mod, lvl, fmt) id,
+        LOG_FORMATS(LOG_X_ID)
+#undef LOG_X_ID
+            ID_COUNT
+    };
+
+    struct Format
+    {
+        Module module;
+        Level level;
+        const char *fmt;
+    };
+
+    constexpr Format FORMATS[ID_COUNT] = {
+#define LOG_X_FORMAT(id, mod, lvl, fmt) {MOD_##mod, LVL_##lvl, fmt},
+        LOG_FORMATS(LOG_X_FORMAT)
+#undef LOG_X_FORMAT
+    };
+
+    constexpr const char *MODULE_NAMES[MOD_COUNT] = {
+#define LOG_X_MODULE_NAME(name, str) str,
+        LOG_MODULES(LOG_X_MODULE_NAME)
+#undef LOG_X_MODULE_NAME
+    };
+
+    // FNV-1a：每个格式串后混入 0xFF 作分隔。写成单 return 的递归形式，保持 C++11 constexpr 可用
+    constexpr uint32_t fnvFormat(const char *p, uint32_t h)
+    {
+        return *p ? fnvFormat(p + 1, (h ^ (uint8_t)*p) * 16777619u) : (h ^ 0xFF) * 16777619u;
+    }
+
+    constexpr uint32_t fnvFormats(size_t i, uint32_t h)
+    {
+        return i < ID_COUNT ? fnvFormats(i + 1, fnvFormat(FORMATS[i].fmt, h)) : h;
+    }
+
+    // 格式表的 FNV-1a 哈希，写入下载文件头，解码端据此判断格式表是否一致
+    constexpr uint32_t formatHash()
+    {
+        return fnvFormats(0, 2166136261u);
+    }
+
+    // 下载文件格式：FileHeader 后紧跟 count 条定长 Record，按时间顺序（均为小端）
+    struct __attribute__((packed)) FileHeader
+    {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t recordSize;
+        uint32_t count;
+        uint32_t evicted; // 被覆盖的旧记录数
+        uint32_t formatHash;
+    };
+
+    struct __attribute__((packed)) Record
+    {
+        uint32_t tUs;
+        uint16_t id;
+        uint8_t argc;
+        uint8_t reserved;
+        int32_t args[MAX_ARGS];
+    };
+
+    // 创建排空任务
+    void begin();
+    // 只能在 loop 任务中调用（单生产者）；级别被过滤的记录不写入
+    void record(Id id, uint8_t argc, const int32_t *args);
+
+    template <typename... A>
+    inline void write(Id id, A... args)
+    {
+        static_assert(sizeof...(A) <= MAX_ARGS, "too many log arguments");
+        const int32_t a[MAX_ARGS] = {(int32_t)args...};
+        record(id, (uint8_t)sizeof...(A), a);
+    }
+
+    // 把尚未输出的记录格式化后写到串口，返回处理的条数；排空任务周期调用
+    size_t drain(size_t maxRecords);
+    // 按 "%d" 等整数转换格式化一条记录（不含换行）
+    size_t format(const Record &r, char *buf, size_t cap);
+
+    // module 为模块名或 "all"，level 为 error/warn/info/debug
+    bool setLevel(const char *module, const char *level);
+    const char *getLevelStr(Level level);
+
+    uint32_t getWritten();
+    uint32_t getDropped();
+    void fillFileHeader(FileHeader &h);
+    // 按时间顺序取出记录区：环形回绕时分为两段，第二段可能为空
+    void getSegments(const uint8_t **a, size_t *alen, const uint8_t **b, size_t *blen);
+    // evt 为 log 的状态 JSON（各模块级别与计数）
+    size_t writeJson(char *buf, size_t cap);
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+// 日志模块：X(枚举名, 名称)
+#define LOG_MODULES(X)    \
+    X(WS, "ws")           \
+    X(NET, "net")         \
+    X(STORAGE, "storage") \
+    X(SCHED, "sched")
+
+// 日志格式表：X(格式 id, 模块, 级别, 格式串)
+// 记录中只保存 id 与最多 4 个 32 位整数参数，格式串只能使用整数转换（%d / %u / %x）。
+// id 即在表中的位置，只在末尾追加；修改已有条目后旧的下载文件会被 logdecode 报告为格式表不匹配
+#define LOG_FORMATS(X)                                                                          \
+    X(WS_CONNECTED, WS, INFO, "Websocket connected clients=%d")                                 \
+    X(WS_DISCONNECTED, WS, INFO, "Websocket disconnected clients=%d")                           \
+    X(WS_STATIONS, WS, INFO, "WiFi stations=%d")                                                \
+    X(NET_WS_CLIENT_CONNECTED, NET, DEBUG, "WS client #%d connected")                           \
+    X(NET_WS_CLIENT_DISCONNECTED, NET, DEBUG, "WS client #%d disconnected")                     \
+    X(NET_NO_STATIONS, NET, INFO, "WiFi: no stations connected")                                \
+    X(NET_STATIONS, NET, INFO, "WiFi: stations connected=%d")                                   \
+    X(STORAGE_OPEN_FAILED, STORAGE, ERROR, "Failed to open state.json for writing")             \
+    X(STORAGE_SAVED, STORAGE, INFO, "State saved to /state.json (%u bytes, %u us)")             \
+    X(STORAGE_SCHEDULE_OPEN_FAILED, STORAGE, ERROR, "Failed to open schedule.json for writing") \
+    X(STORAGE_SCHEDULE_READ_FAILED, STORAGE, ERROR, "fail to open /schedule.json")              \
+    X(STORAGE_SCHEDULE_PARSE_FAILED, STORAGE, ERROR, "fail to parse schedule.json")             \
+    X(SCHED_LOADED, SCHED, INFO, "Loaded schedule.json rules=%d armed=%d")
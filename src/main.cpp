@@ -4,10 +4,24 @@
 #include "storage.h"
 #include "websocket_handler.h"
 #include "status_reporter.h"
+#include "metrics.h"
+#include "profiler.h"
+#include "stall_watchdog.h"
+#include "alloc_stats.h"
+#include "audio_input.h"
+#include "scheduler.h"
+#include "group_sync.h"
+#include "ota_update.h"
+#include "log.h"
+#include "event_log.h"
 
 // Config
 #define AP_SSID "ESP32C3_LED_AP"
 #define AP_PSK "12345678"  
+// 单次 loop 的时间预算（us），超出计入剖析器的 over_budget
+#define LOOP_BUDGET_US 5000
+// loop 超过该时长（ms）未完成一次迭代即视为卡顿并记录现场
+#define STALL_THRESHOLD_MS 500
 
 unsigned long lastStatusMillis = 0;
 
@@ -16,6 +30,12 @@ void setup()
   Serial.begin(115200);
   delay(200);
 
+  // 最先初始化指标注册表，后续模块初始化过程中的计数也能被记录
+  Metrics::begin();
+  AllocStats::begin();
+  // 二进制日志：之后各模块的运行期日志写入 RAM 环形缓冲，由空闲任务输出到串口
+  Log::begin();
+
   // 初始化 SPIFFS（用于持久化 state 并提供网页）
   if (!Storage::begin())
   {
@@ -31,37 +51,86 @@ void setup()
 
   // 初始化 LED 控制器（从 Storage 读取初始状态并生效）
   LedController::begin();
+  AudioInput::begin();
+
+  // 加载定时规则（依赖 Storage 与 LedController）
+  Scheduler::begin();
 
   // 初始化网络（SoftAP、HTTP 与 WebSocket 服务器）
   Network::begin(AP_SSID, AP_PSK);
 
+  // 恢复群控角色（依赖网络已启动）
+  GroupSync::begin();
+
+  // 广播事件的序号与重连补发缓冲
+  EventLog::begin();
+
   // 初始化 websocket handler（使用 Network 提供的 wsServer）
   WebsocketHandler::begin(Network::getWebSocketServer());
 
   // 初始化状态上报模块
   StatusReporter::begin();
 
+#ifdef LOOP_PROFILER
+  Profiler::begin(LOOP_BUDGET_US);
+#endif
+
+  // 最后启动卡顿看门狗，避免把初始化过程误判为卡顿
+  StallWatchdog::begin(STALL_THRESHOLD_MS);
+
   Serial.println("Setup complete");
 }
 
 void loop()
 {
-  // 轮询网络与 WebSocket
-  Network::loop();
+  unsigned long loopStartUs = micros();
+  {
+    PROFILE_SCOPE(SEC_LOOP);
 
-  // 轮询 LED 控制器（用于 breathe/flash 时间步进）
-  LedController::update();
+    // 轮询网络与 WebSocket
+    {
+      PROFILE_SCOPE(SEC_NETWORK);
+      Network::loop();
+    }
 
-  // 轮询 websocket handler（处理缓存/重发等）
-  WebsocketHandler::loop();
+    // 轮询 LED 控制器（用于 breathe/flash 时间步进）
+    {
+      PROFILE_SCOPE(SEC_LED);
+      AudioInput::loop();
+      LedController::update();
+    }
 
-  // 定期广播状态（例如每 2000ms）
-  unsigned long now = millis();
-  if (now - lastStatusMillis > 2000)
-  {
-    lastStatusMillis = now;
-    StatusReporter::broadcast();
+    // 推进定时规则的时间轮（每秒一格），到期动作在此执行
+    Scheduler::loop();
+
+    // 群控：leader 发送信标，member 接收并对齐相位
+    GroupSync::loop();
+
+    // OTA 超时检测，成功后延迟重启
+    OtaUpdate::loop();
+
+    // 轮询 websocket handler（处理缓存/重发等）
+    {
+      PROFILE_SCOPE(SEC_WS);
+      WebsocketHandler::loop();
+    }
+
+    // 定期广播状态（例如每 2000ms）
+    unsigned long now = millis();
+    if (now - lastStatusMillis > 2000)
+    {
+      PROFILE_SCOPE(SEC_BROADCAST);
+      lastStatusMillis = now;
+      StatusReporter::broadcast();
+    }
+
+    // 刷新 heap 指标并记录本次循环耗时（不含下面的 delay）
+    Metrics::loop();
+    Metrics::observe(Metrics::HIST_LOOP_US, micros() - loopStartUs);
   }
 
+  // 通知看门狗本次迭代已完成
+  StallWatchdog::feed();
+
   delay(1); // 让出少量 CPU 时间
 }
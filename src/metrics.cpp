@@ -0,0 +1,265 @@
+#include "metrics.h"
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <esp_heap_caps.h>
+#include "alloc_stats.h"
+#include "msg_pool.h"
+#include <stdarg.h>
+
+namespace Metrics
+{
+    struct Hist
+    {
+        uint32_t buckets[HIST_BUCKETS];
+        uint32_t count;
+        uint64_t sum;
+        uint32_t max;
+    };
+
+    static constexpr const char *counterNames[CNT_COUNT] = {
+        "ws_messages_in_total",
+        "ws_messages_out_total",
+        "commands_total",
+        "command_errors_total",
+        "flash_writes_total",
+        "heap_allocs_total",
+        "command_heap_allocs_total",
+        "msg_pool_exhausted_total",
+        "stream_frames_total",
+        "stream_underruns_total",
+        "stream_overruns_total",
+        "stream_late_samples_total",
+    };
+    static constexpr const char *gaugeNames[GAUGE_COUNT] = {
+        "free_heap_bytes",
+        "largest_free_block_bytes",
+        "min_free_heap_bytes",
+        "heap_fragmentation_percent",
+        "last_command_heap_allocs",
+        "ws_clients",
+    };
+    static constexpr const char *histNames[HIST_COUNT] = {
+        "loop_duration_us",
+        "command_duration_us",
+    };
+
+    static constexpr bool namesFit(const char *const *names, int n)
+    {
+        for (int i = 0; i < n; ++i)
+        {
+            size_t len = 0;
+            while (names[i][len])
+                len++;
+            if (len > NAME_MAX_LEN)
+                return false;
+        }
+        return true;
+    }
+    static_assert(namesFit(counterNames, CNT_COUNT) && namesFit(gaugeNames, GAUGE_COUNT) && namesFit(histNames, HIST_COUNT),
+                  "metric name longer than NAME_MAX_LEN, PROMETHEUS_MAX_LEN no longer bounds the output");
+    static_assert(MAX_CLIENTS <= 999, "client label assumed to be at most 3 digits");
+
+    static uint32_t counters[CNT_COUNT];
+    static int32_t gauges[GAUGE_COUNT];
+    static Hist hists[HIST_COUNT];
+    static uint32_t clientMsgsIn[MAX_CLIENTS];
+    static uint32_t clientMsgsOut[MAX_CLIENTS];
+    static unsigned long lastSampleMs = 0;
+
+    // heap 采样间隔（ms）：heap_caps_get_largest_free_block 需要遍历空闲链表，不宜每次 loop 调用
+    constexpr unsigned long SAMPLE_INTERVAL_MS = 1000;
+
+    static void sampleHeap()
+    {
+        uint32_t freeHeap = ESP.getFreeHeap();
+        uint32_t largest = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+        gauges[GAUGE_FREE_HEAP] = (int32_t)freeHeap;
+        gauges[GAUGE_LARGEST_FREE_BLOCK] = (int32_t)largest;
+        gauges[GAUGE_MIN_FREE_HEAP] = (int32_t)ESP.getMinFreeHeap();
+        gauges[GAUGE_HEAP_FRAG_PCT] = freeHeap ? (int32_t)(100 - (uint64_t)largest * 100 / freeHeap) : 0;
+        counters[CNT_HEAP_ALLOCS] = AllocStats::getTotal();
+        counters[CNT_POOL_EXHAUSTED] = MsgPool::getExhausted();
+    }
+
+    // 值落在哪个桶：v <= 2^i 的最小 i
+    static int bucketOf(uint32_t v)
+    {
+        if (v <= 1)
+            return 0;
+        int b = 32 - __builtin_clz(v - 1);
+        return b < HIST_BUCKETS - 1 ? b : HIST_BUCKETS - 1;
+    }
+
+    // 根据分桶估算分位数（返回所在桶的上界）
+    static uint32_t quantile(const Hist &h, float q)
+    {
+        if (h.count == 0)
+            return 0;
+        uint32_t target = (uint32_t)(q * (float)h.count);
+        uint32_t acc = 0;
+        for (int i = 0; i < HIST_BUCKETS - 1; ++i)
+        {
+            acc += h.buckets[i];
+            if (acc > target)
+                return 1u << i;
+        }
+        return h.max;
+    }
+
+    void begin()
+    {
+        memset(counters, 0, sizeof(counters));
+        memset(gauges, 0, sizeof(gauges));
+        memset(hists, 0, sizeof(hists));
+        memset(clientMsgsIn, 0, sizeof(clientMsgsIn));
+        memset(clientMsgsOut, 0, sizeof(clientMsgsOut));
+        sampleHeap();
+        lastSampleMs = millis();
+    }
+
+    void loop()
+    {
+        unsigned long now = millis();
+        if (now - lastSampleMs >= SAMPLE_INTERVAL_MS)
+        {
+            lastSampleMs = now;
+            sampleHeap();
+        }
+    }
+
+    void inc(Counter c, uint32_t n)
+    {
+        counters[c] += n;
+    }
+
+    void set(Gauge g, int32_t v)
+    {
+        gauges[g] = v;
+    }
+
+    void observe(Histogram h, uint32_t us)
+    {
+        Hist &hist = hists[h];
+        hist.buckets[bucketOf(us)]++;
+        hist.count++;
+        hist.sum += us;
+        if (us > hist.max)
+            hist.max = us;
+    }
+
+    void clientIn(uint8_t num)
+    {
+        counters[CNT_WS_MSGS_IN]++;
+        if (num < MAX_CLIENTS)
+            clientMsgsIn[num]++;
+    }
+
+    void clientOut(uint8_t num)
+    {
+        counters[CNT_WS_MSGS_OUT]++;
+        if (num < MAX_CLIENTS)
+            clientMsgsOut[num]++;
+    }
+
+    uint32_t getCounter(Counter c)
+    {
+        return counters[c];
+    }
+
+    int32_t getGauge(Gauge g)
+    {
+        return gauges[g];
+    }
+
+    // 追加格式化文本；缓冲区不足时截断并停止写入
+    static void appendf(char *buf, size_t cap, size_t &len, const char *fmt, ...)
+    {
+        if (len + 1 >= cap)
+            return;
+        va_list ap;
+        va_start(ap, fmt);
+        int n = vsnprintf(buf + len, cap - len, fmt, ap);
+        va_end(ap);
+        if (n < 0)
+            return;
+        len += (size_t)n < cap - len ? (size_t)n : cap - len - 1;
+    }
+
+    size_t writePrometheus(char *buf, size_t cap)
+    {
+        size_t len = 0;
+        if (cap)
+            buf[0] = '\0';
+        appendf(buf, cap, len, "# TYPE stupid_led_uptime_seconds gauge\nstupid_led_uptime_seconds %lu\n", (unsigned long)(millis() / 1000));
+        for (int i = 0; i < CNT_COUNT; ++i)
+        {
+            appendf(buf, cap, len, "# TYPE stupid_led_%s counter\nstupid_led_%s %lu\n",
+                    counterNames[i], counterNames[i], (unsigned long)counters[i]);
+        }
+        for (int i = 0; i < GAUGE_COUNT; ++i)
+        {
+            appendf(buf, cap, len, "# TYPE stupid_led_%s gauge\nstupid_led_%s %ld\n",
+                    gaugeNames[i], gaugeNames[i], (long)gauges[i]);
+        }
+        appendf(buf, cap, len, "# TYPE stupid_led_client_messages_total counter\n");
+        for (int c = 0; c < MAX_CLIENTS; ++c)
+        {
+            if (clientMsgsIn[c] == 0 && clientMsgsOut[c] == 0)
+                continue;
+            appendf(buf, cap, len, "stupid_led_client_messages_total{client=\"%d\",dir=\"in\"} %lu\n", c, (unsigned long)clientMsgsIn[c]);
+            appendf(buf, cap, len, "stupid_led_client_messages_total{client=\"%d\",dir=\"out\"} %lu\n", c, (unsigned long)clientMsgsOut[c]);
+        }
+        for (int h = 0; h < HIST_COUNT; ++h)
+        {
+            const Hist &hist = hists[h];
+            appendf(buf, cap, len, "# TYPE stupid_led_%s histogram\n", histNames[h]);
+            // Prometheus 直方图的桶是累计计数；空的前缀桶省略以控制输出体积
+            uint32_t acc = 0;
+            for (int i = 0; i < HIST_BUCKETS - 1; ++i)
+            {
+                acc += hist.buckets[i];
+                if (acc == 0)
+                    continue;
+                appendf(buf, cap, len, "stupid_led_%s_bucket{le=\"%lu\"} %lu\n", histNames[h], (unsigned long)(1u << i), (unsigned long)acc);
+            }
+            appendf(buf, cap, len, "stupid_led_%s_bucket{le=\"+Inf\"} %lu\n", histNames[h], (unsigned long)hist.count);
+            appendf(buf, cap, len, "stupid_led_%s_sum %llu\n", histNames[h], (unsigned long long)hist.sum);
+            appendf(buf, cap, len, "stupid_led_%s_count %lu\n", histNames[h], (unsigned long)hist.count);
+        }
+        return len;
+    }
+
+    size_t writeJson(char *buf, size_t cap)
+    {
+        // 文档较大，放在静态区避免占用 loop 任务栈
+        static StaticJsonDocument<1536> doc;
+        doc.clear();
+        doc["evt"] = "metrics";
+        doc["uptime"] = (unsigned long)(millis() / 1000);
+        JsonObject cnt = doc.createNestedObject("counters");
+        for (int i = 0; i < CNT_COUNT; ++i)
+            cnt[counterNames[i]] = counters[i];
+        JsonObject g = doc.createNestedObject("gauges");
+        for (int i = 0; i < GAUGE_COUNT; ++i)
+            g[gaugeNames[i]] = gauges[i];
+        JsonArray in = doc.createNestedArray("client_in");
+        JsonArray out = doc.createNestedArray("client_out");
+        for (int c = 0; c < MAX_CLIENTS; ++c)
+        {
+            in.add(clientMsgsIn[c]);
+            out.add(clientMsgsOut[c]);
+        }
+        JsonObject hs = doc.createNestedObject("histograms");
+        for (int h = 0; h < HIST_COUNT; ++h)
+        {
+            const Hist &hist = hists[h];
+            JsonObject o = hs.createNestedObject(histNames[h]);
+            o["count"] = hist.count;
+            o["sum"] = hist.sum;
+            o["max"] = hist.max;
+            o["p50"] = quantile(hist, 0.50f);
+            o["p99"] = quantile(hist, 0.99f);
+        }
+        return serializeJson(doc, buf, cap);
+    }
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// 运行时指标注册表：固定数量的计数器、仪表与对数分桶直方图
+// 所有记录都在 loop 任务中完成（单写者），记录路径只有几次整数运算，可常开
+namespace Metrics
+{
+    enum Counter
+    {
+        CNT_WS_MSGS_IN,
+        CNT_WS_MSGS_OUT,
+        CNT_COMMANDS,
+        CNT_COMMAND_ERRORS,
+        CNT_FLASH_WRITES,
+        CNT_HEAP_ALLOCS,   // 全部任务的 heap 分配次数（需启用 ALLOC_HOOK）
+        CNT_COMMAND_ALLOCS, // 命令处理期间 loop 任务的 heap 分配次数
+        CNT_POOL_EXHAUSTED, // 消息缓冲池耗尽次数
+        CNT_STREAM_FRAMES,  // 收到的流式二进制帧数
+        CNT_STREAM_UNDERRUNS,
+        CNT_STREAM_OVERRUNS,
+        CNT_STREAM_LATE,
+        CNT_COUNT
+    };
+
+    enum Gauge
+    {
+        GAUGE_FREE_HEAP,
+        GAUGE_LARGEST_FREE_BLOCK,
+        GAUGE_MIN_FREE_HEAP,
+        GAUGE_HEAP_FRAG_PCT, // 碎片率：100 - 最大空闲块 / 空闲总量
+        GAUGE_LAST_COMMAND_ALLOCS,
+        GAUGE_WS_CLIENTS,
+        GAUGE_COUNT
+    };
+
+    enum Histogram
+    {
+        HIST_LOOP_US,
+        HIST_COMMAND_US,
+        HIST_COUNT
+    };
+
+    // 每个客户端单独统计收发消息数（与 WebSocketsServer 的客户端槽位一一对应）
+    constexpr int MAX_CLIENTS = 8;
+    // 直方图桶：第 i 个桶的上界为 2^i 微秒，最后一个桶为 +Inf
+    constexpr int HIST_BUCKETS = 21;
+
+    void begin();
+    // 周期性刷新 heap 相关仪表（内部限速，可在每次 loop 调用）
+    void loop();
+
+    void inc(Counter c, uint32_t n = 1);
+    void set(Gauge g, int32_t v);
+    void observe(Histogram h, uint32_t us);
+    void clientIn(uint8_t num);
+    void clientOut(uint8_t num);
+
+    uint32_t getCounter(Counter c);
+    int32_t getGauge(Gauge g);
+
+    // 指标名（不含 stupid_led_ 前缀）的最大长度，metrics.cpp 中用 static_assert 检查
+    constexpr size_t NAME_MAX_LEN = 28;
+    // writePrometheus 的输出长度上界：每行按最长的名称与数值位数（u32 10 位、i32 11 位、u64 20 位）累加，
+    // 直方图的每个桶与每个客户端槽位都计入
+    constexpr size_t PROM_COUNTER_LEN = 50 + 2 * NAME_MAX_LEN;
+    constexpr size_t PROM_GAUGE_LEN = 49 + 2 * NAME_MAX_LEN;
+    constexpr size_t PROM_CLIENT_LEN = 2 * 68;
+    constexpr size_t PROM_HIST_LEN = (29 + NAME_MAX_LEN) + (HIST_BUCKETS - 1) * (47 + NAME_MAX_LEN) +
+                                     (41 + NAME_MAX_LEN) + (37 + NAME_MAX_LEN) + (29 + NAME_MAX_LEN);
+    constexpr size_t PROMETHEUS_MAX_LEN = 80 + CNT_COUNT * PROM_COUNTER_LEN + GAUGE_COUNT * PROM_GAUGE_LEN +
+                                          48 + MAX_CLIENTS * PROM_CLIENT_LEN + HIST_COUNT * PROM_HIST_LEN;
+
+    // 以 Prometheus 文本格式 / JSON 写入调用方提供的缓冲区，返回写入长度；
+    // writePrometheus 的缓冲区不小于 PROMETHEUS_MAX_LEN + 1 时不会截断
+    size_t writePrometheus(char *buf, size_t cap);
+    size_t writeJson(char *buf, size_t cap);
+}
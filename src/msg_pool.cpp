@@ -0,0 +1,41 @@
+#include "msg_pool.h"
+
+namespace MsgPool
+{
+    static char buffers[BUF_COUNT][BUF_SIZE];
+    static uint32_t usedMask = 0;
+    static uint32_t exhausted = 0;
+
+    static_assert(BUF_COUNT <= 32, "usedMask holds one bit per buffer");
+
+    char *acquire()
+    {
+        for (int i = 0; i < BUF_COUNT; ++i)
+        {
+            if (!(usedMask & (1u << i)))
+            {
+                usedMask |= 1u << i;
+                return buffers[i];
+            }
+        }
+        exhausted++;
+        return nullptr;
+    }
+
+    void release(char *buf)
+    {
+        int i = (int)((buf - buffers[0]) / (ptrdiff_t)BUF_SIZE);
+        if (i >= 0 && i < BUF_COUNT && buf == buffers[i])
+            usedMask &= ~(1u << i);
+    }
+
+    int getInUse()
+    {
+        return __builtin_popcount(usedMask);
+    }
+
+    uint32_t getExhausted()
+    {
+        return exhausted;
+    }
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// 固定大小的消息缓冲池：替代热路径上的临时 String，稳态下不触碰 heap
+// 只在 loop 任务中使用（WebSocket/HTTP 回调都在 loop 中执行），因此无需加锁
+namespace MsgPool
+{
+    constexpr size_t BUF_SIZE = 512;
+    constexpr int BUF_COUNT = 4;
+
+    // 池耗尽时返回 nullptr，调用方应放弃本次发送
+    char *acquire();
+    void release(char *buf);
+    int getInUse();
+    uint32_t getExhausted();
+
+    // 作用域内持有一个池缓冲，析构时自动归还
+    class Buffer
+    {
+    public:
+        Buffer() : buf_(acquire()) {}
+        ~Buffer()
+        {
+            if (buf_)
+                release(buf_);
+        }
+        Buffer(const Buffer &) = delete;
+        Buffer &operator=(const Buffer &) = delete;
+
+        char *data() { return buf_; }
+        size_t capacity() const { return buf_ ? BUF_SIZE : 0; }
+        explicit operator bool() const { return buf_ != nullptr; }
+
+    private:
+        char *buf_;
+    };
+}
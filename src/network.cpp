@@ -3,15 +3,22 @@
 #include <WebServer.h>
 #include <SPIFFS.h>
 #include "led_controller.h"
+#include "status_reporter.h"
+#include "metrics.h"
+#include "stall_watchdog.h"
+#include "ws_trace.h"
+#include "scheduler.h"
+#include "group_sync.h"
+#include "ota_update.h"
+#include "log.h"
 
 static WebServer httpServer(80);
 static WebSocketsServer *wsServer = nullptr;
 // 跟踪上一次的 station 数，用于检测 WiFi 客户端连接/断开事件
 static int prevStations = -1;
 
-static void handleRoot()
-{
-    httpServer.send(200, "text/html", R"rawliteral(
+// 内嵌网页：常量数组直接从 flash 发送，避免每次请求在 heap 上复制整页
+static const char INDEX_HTML[] PROGMEM = R"rawliteral(
 <!doctype html>
 <html lang="en">
 <head>
@@ -50,6 +57,7 @@ static void handleRoot()
                         <button class="mode-btn" onclick="setMode('off')">Off</button>
                         <button class="mode-btn" onclick="setMode('blink')">Blink</button>
                         <button class="mode-btn" onclick="setMode('breathe')">Breathe</button>
+                        <button class="mode-btn" onclick="setMode('audio')">Audio</button>
                     </div>
                 </div>
                 <div class="col right">
@@ -108,15 +116,20 @@ static void handleRoot()
         // editing state / timers for revert behavior
         let editingHz = false, editingPeriod = false;
         let hzTimer = null, periodTimer = null;
+        // last seen event sequence / device boot epoch: reconnects resume instead of resyncing
+        let lastSeq = null, bootEpoch = null;
 
         function connect(){
-            const url = 'ws://' + location.hostname + ':81/';
+            let url = 'ws://' + location.hostname + ':81/';
+            if(lastSeq !== null) url += '?resume=' + lastSeq + (bootEpoch !== null ? '&epoch=' + bootEpoch : '');
             ws = new WebSocket(url);
             ws.addEventListener('open', ()=>{ document.getElementById('wsstate').innerText = 'connected'; });
             ws.addEventListener('close', ()=>{ document.getElementById('wsstate').innerText = 'disconnected'; setTimeout(connect,1000); });
             ws.addEventListener('message', (evt)=>{
                 try{
                     const obj = JSON.parse(evt.data);
+                    if(typeof obj.seq !== 'undefined') lastSeq = obj.seq;
+                    if(typeof obj.epoch !== 'undefined') bootEpoch = obj.epoch;
                     // Show latest full message JSON in the Message box (including dropped)
                     document.getElementById('message').innerText = JSON.stringify(obj, null, 2);
                     // keep UI controls in sync when status-like messages arrive
@@ -222,7 +235,109 @@ static void handleRoot()
     </script>
 </body>
 </html>
-)rawliteral");
+)rawliteral";
+
+static void handleRoot()
+{
+    httpServer.send_P(200, "text/html", INDEX_HTML, sizeof(INDEX_HTML) - 1);
+}
+
+// Prometheus 文本格式的指标，供集中抓取
+static void handleMetrics()
+{
+    static char buf[Metrics::PROMETHEUS_MAX_LEN + 1];
+    size_t len = Metrics::writePrometheus(buf, sizeof(buf));
+    httpServer.send_P(200, "text/plain; version=0.0.4", buf, len);
+}
+
+// loop 卡顿记录（JSON），用于事后诊断现场卡顿
+static void handleStalls()
+{
+    static char buf[2048];
+    size_t len = StallWatchdog::writeJson(buf, sizeof(buf));
+    httpServer.send_P(200, "application/json", buf, len);
+}
+
+// OTA 进度（JSON）
+static void handleOtaStatus()
+{
+    static char buf[256];
+    size_t len = OtaUpdate::writeJson(buf, sizeof(buf));
+    httpServer.send_P(200, "application/json", buf, len);
+}
+
+// 当前 HTTP 上传是否持有 OTA 会话（会话可能已被 WebSocket 客户端占用）
+static bool httpOtaActive = false;
+
+// multipart 上传：POST /ota?size=N&sha256=HEX，每块直接写入 OTA 分区
+static void handleOtaUpload()
+{
+    HTTPUpload &up = httpServer.upload();
+    if (up.status == UPLOAD_FILE_START)
+    {
+        httpOtaActive = OtaUpdate::begin((uint32_t)httpServer.arg("size").toInt(), httpServer.arg("sha256").c_str());
+    }
+    else if (!httpOtaActive)
+    {
+        return;
+    }
+    else if (up.status == UPLOAD_FILE_WRITE)
+    {
+        OtaUpdate::write(OtaUpdate::getReceived(), up.buf, up.currentSize);
+        // WebServer 在一次 handleClient 内读完整个请求体，这里推进 LED，上传期间动画不中断
+        LedController::update();
+    }
+    else if (up.status == UPLOAD_FILE_END)
+    {
+        if (OtaUpdate::getState() == OtaUpdate::OTA_RECEIVING)
+            OtaUpdate::finish();
+    }
+    else
+    {
+        OtaUpdate::abort("aborted");
+    }
+}
+
+static void handleOtaDone()
+{
+    httpOtaActive = false;
+    static char buf[256];
+    size_t len = OtaUpdate::writeJson(buf, sizeof(buf));
+    httpServer.send_P(OtaUpdate::getState() == OtaUpdate::OTA_DONE ? 200 : 400, "application/json", buf, len);
+}
+
+// 下载二进制日志（格式见 log.h），用 program logdecode 还原为文本
+static void handleLog()
+{
+    Log::FileHeader h;
+    Log::fillFileHeader(h);
+    const uint8_t *a, *b;
+    size_t alen, blen;
+    Log::getSegments(&a, &alen, &b, &blen);
+    httpServer.setContentLength(sizeof(h) + alen + blen);
+    httpServer.send(200, "application/octet-stream", "");
+    httpServer.sendContent((const char *)&h, sizeof(h));
+    if (alen)
+        httpServer.sendContent((const char *)a, alen);
+    if (blen)
+        httpServer.sendContent((const char *)b, blen);
+}
+
+// 下载 WebSocket 流量录制（二进制，格式见 ws_trace.h），环形缓冲按两段直接发送，不做复制
+static void handleTrace()
+{
+    WsTrace::FileHeader h;
+    WsTrace::fillFileHeader(h);
+    const uint8_t *a, *b;
+    size_t alen, blen;
+    WsTrace::getSegments(&a, &alen, &b, &blen);
+    httpServer.setContentLength(sizeof(h) + alen + blen);
+    httpServer.send(200, "application/octet-stream", "");
+    httpServer.sendContent((const char *)&h, sizeof(h));
+    if (alen)
+        httpServer.sendContent((const char *)a, alen);
+    if (blen)
+        httpServer.sendContent((const char *)b, blen);
 }
 
 void Network::begin(const char *ssid, const char *password)
@@ -236,6 +351,14 @@ void Network::begin(const char *ssid, const char *password)
     {
         WiFi.softAP(ssid);
     }
+#ifdef GROUP_STA_SSID
+    // 群控需要多台设备处于同一网络：同时以 station 接入共同的路由器（SoftAP 保持可用）
+#ifndef GROUP_STA_PSK
+#define GROUP_STA_PSK ""
+#endif
+    WiFi.mode(WIFI_AP_STA);
+    WiFi.begin(GROUP_STA_SSID, GROUP_STA_PSK);
+#endif
     IPAddress apIP = WiFi.softAPIP();
     Serial.printf("SSID: %s  Password: %s\n", ssid, password ? password : "(none)");
     Serial.print("AP IP: ");
@@ -243,6 +366,12 @@ void Network::begin(const char *ssid, const char *password)
 
     // 启动 HTTP 服务器
     httpServer.on("/", handleRoot);
+    httpServer.on("/metrics", HTTP_GET, handleMetrics);
+    httpServer.on("/stalls", HTTP_GET, handleStalls);
+    httpServer.on("/trace", HTTP_GET, handleTrace);
+    httpServer.on("/log", HTTP_GET, handleLog);
+    httpServer.on("/ota", HTTP_GET, handleOtaStatus);
+    httpServer.on("/ota", HTTP_POST, handleOtaDone, handleOtaUpload);
     httpServer.begin();
     Serial.println("HTTP server started");
 
@@ -255,9 +384,9 @@ void Network::begin(const char *ssid, const char *password)
     // 如果 websocket_handler 未链接到这里，websocket_handler 会在 begin 时自行注册回调。
 
     if(type == WStype_CONNECTED){
-      Serial.printf("WS client #%d connected\n", num);
+      Log::write(Log::NET_WS_CLIENT_CONNECTED, num);
     } else if(type == WStype_DISCONNECTED){
-      Serial.printf("WS client #%d disconnected\n", num);
+      Log::write(Log::NET_WS_CLIENT_DISCONNECTED, num);
     } });
 
     Serial.println("WebSocket server started on port 81");
@@ -279,17 +408,19 @@ void Network::loop()
     {
         if (stations == 0)
         {
-            Serial.println("WiFi: no stations connected");
-            // wifi连接断开，进入呼吸模式
-            LedController::enterBreatheWait();
+            Log::write(Log::NET_NO_STATIONS);
+            // wifi连接断开，进入呼吸模式（有定时规则在运行或参与群控时保持当前程序）
+            if (Scheduler::getArmedCount() == 0 && GroupSync::getRole() == GroupSync::ROLE_NONE)
+                LedController::enterBreatheWait();
         }
         else
         {
-            Serial.printf("WiFi: stations connected=%d\n", stations);
+            Log::write(Log::NET_STATIONS, stations);
             // 有新的wifi连接，退出呼吸模式
             LedController::onClientConnected();
         }
         prevStations = stations;
+        StatusReporter::invalidate();
     }
 }
 
@@ -298,6 +429,11 @@ WebSocketsServer *Network::getWebSocketServer()
     return wsServer;
 }
 
+WebServer *Network::getHttpServer()
+{
+    return &httpServer;
+}
+
 IPAddress Network::getAPIP()
 {
     return WiFi.softAPIP();
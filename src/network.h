@@ -1,11 +1,13 @@
 #pragma once
 #include <WebSocketsServer.h>
+#include <WebServer.h>
 
 namespace Network
 {
     void begin(const char *ssid, const char *password);
     void loop();
     WebSocketsServer *getWebSocketServer();
+    WebServer *getHttpServer();
     IPAddress getAPIP();
     int getClientCount();
 }
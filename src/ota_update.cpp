@@ -0,0 +1,250 @@
+#include "ota_update.h"
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <esp_ota_ops.h>
+#include <mbedtls/sha256.h>
+
+namespace OtaUpdate
+{
+    // 超过该时长没有收到数据视为客户端已放弃，释放分区句柄
+    constexpr unsigned long IDLE_TIMEOUT_MS = 15000;
+    // 成功后延迟重启，留出时间把最终状态发给客户端
+    constexpr unsigned long RESTART_DELAY_MS = 1000;
+
+    static State state = OTA_IDLE;
+    static const char *error = "";
+    static const esp_partition_t *partition = nullptr;
+    static esp_ota_handle_t handle = 0;
+    static mbedtls_sha256_context sha;
+    static uint8_t expected[32];
+    static uint32_t total = 0;
+    static uint32_t received = 0;
+    static unsigned long startMs = 0;
+    static unsigned long lastDataMs = 0;
+    static unsigned long doneMs = 0;
+
+    static int hexNibble(char c)
+    {
+        if (c >= '0' && c <= '9')
+            return c - '0';
+        if (c >= 'a' && c <= 'f')
+            return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F')
+            return c - 'A' + 10;
+        return -1;
+    }
+
+    static bool parseHex(const char *hex, uint8_t out[32])
+    {
+        if (!hex || strlen(hex) != 64)
+            return false;
+        for (int i = 0; i < 32; ++i)
+        {
+            int hi = hexNibble(hex[i * 2]), lo = hexNibble(hex[i * 2 + 1]);
+            if (hi < 0 || lo < 0)
+                return false;
+            out[i] = (uint8_t)(hi << 4 | lo);
+        }
+        return true;
+    }
+
+    static void fail(const char *reason)
+    {
+        if (state == OTA_RECEIVING)
+        {
+            esp_ota_abort(handle);
+            mbedtls_sha256_free(&sha);
+        }
+        state = OTA_ERROR;
+        error = reason;
+        Serial.printf("OTA failed: %s (%u/%u bytes)\n", reason, received, total);
+    }
+
+    bool begin(uint32_t size, const char *sha256Hex)
+    {
+        if (state == OTA_RECEIVING)
+        {
+            error = "busy";
+            return false;
+        }
+        received = 0;
+        total = size;
+        if (!parseHex(sha256Hex, expected))
+        {
+            state = OTA_ERROR;
+            error = "bad_sha256";
+            return false;
+        }
+        partition = esp_ota_get_next_update_partition(nullptr);
+        if (!partition)
+        {
+            state = OTA_ERROR;
+            error = "no_partition";
+            return false;
+        }
+        if (size > partition->size)
+        {
+            state = OTA_ERROR;
+            error = "too_large";
+            return false;
+        }
+        // 顺序写模式下按需逐个扇区擦除，避免 begin 一次擦除整个分区而长时间阻塞 loop
+        esp_err_t err = esp_ota_begin(partition, OTA_WITH_SEQUENTIAL_WRITES, &handle);
+        if (err != ESP_OK)
+        {
+            state = OTA_ERROR;
+            error = "begin_failed";
+            Serial.printf("esp_ota_begin: %s\n", esp_err_to_name(err));
+            return false;
+        }
+        mbedtls_sha256_init(&sha);
+        mbedtls_sha256_starts_ret(&sha, 0);
+        state = OTA_RECEIVING;
+        error = "";
+        startMs = lastDataMs = millis();
+        Serial.printf("OTA begin: %u bytes -> %s\n", size, partition->label);
+        return true;
+    }
+
+    bool write(uint32_t offset, const uint8_t *data, size_t len)
+    {
+        if (state != OTA_RECEIVING)
+            return false;
+        if (offset != received)
+        {
+            // 不回退也不中止：客户端可按 received 重新发送
+            error = "bad_offset";
+            return false;
+        }
+        if (total && received + len > total)
+        {
+            fail("size_mismatch");
+            return false;
+        }
+        if (esp_ota_write(handle, data, len) != ESP_OK)
+        {
+            fail("write_failed");
+            return false;
+        }
+        mbedtls_sha256_update_ret(&sha, data, len);
+        received += len;
+        lastDataMs = millis();
+        error = "";
+        if (total && received == total)
+            return finish();
+        return true;
+    }
+
+    bool finish()
+    {
+        if (state != OTA_RECEIVING)
+            return false;
+        if (total && received != total)
+        {
+            fail("size_mismatch");
+            return false;
+        }
+        uint8_t digest[32];
+        mbedtls_sha256_finish_ret(&sha, digest);
+        if (memcmp(digest, expected, sizeof(digest)) != 0)
+        {
+            fail("hash_mismatch");
+            return false;
+        }
+        mbedtls_sha256_free(&sha);
+        // esp_ota_end 校验镜像格式（段表、校验和及镜像自带的 SHA-256），通过后才切换启动分区
+        esp_err_t err = esp_ota_end(handle);
+        if (err != ESP_OK)
+        {
+            state = OTA_ERROR;
+            error = "invalid_image";
+            Serial.printf("esp_ota_end: %s\n", esp_err_to_name(err));
+            return false;
+        }
+        err = esp_ota_set_boot_partition(partition);
+        if (err != ESP_OK)
+        {
+            state = OTA_ERROR;
+            error = "set_boot_failed";
+            Serial.printf("esp_ota_set_boot_partition: %s\n", esp_err_to_name(err));
+            return false;
+        }
+        total = received;
+        state = OTA_DONE;
+        doneMs = millis();
+        Serial.printf("OTA done: %u bytes in %lu ms, restarting\n", received, doneMs - startMs);
+        return true;
+    }
+
+    void abort(const char *reason)
+    {
+        if (state == OTA_RECEIVING)
+            fail(reason);
+    }
+
+    void loop()
+    {
+        if (state == OTA_RECEIVING && millis() - lastDataMs > IDLE_TIMEOUT_MS)
+            fail("timeout");
+        else if (state == OTA_DONE && doneMs && millis() - doneMs > RESTART_DELAY_MS)
+        {
+            doneMs = 0;
+            ESP.restart();
+        }
+    }
+
+    State getState()
+    {
+        return state;
+    }
+
+    const char *getStateStr()
+    {
+        switch (state)
+        {
+        case OTA_RECEIVING:
+            return "receiving";
+        case OTA_DONE:
+            return "done";
+        case OTA_ERROR:
+            return "error";
+        default:
+            return "idle";
+        }
+    }
+
+    const char *getError()
+    {
+        return error;
+    }
+
+    uint32_t getReceived()
+    {
+        return received;
+    }
+
+    uint32_t getTotal()
+    {
+        return total;
+    }
+
+    size_t writeJson(char *buf, size_t cap)
+    {
+        StaticJsonDocument<256> doc;
+        doc["evt"] = "ota";
+        doc["state"] = getStateStr();
+        doc["received"] = received;
+        doc["total"] = total;
+        if (total)
+            doc["pct"] = (uint32_t)((uint64_t)received * 100 / total);
+        if (state != OTA_IDLE)
+        {
+            unsigned long elapsed = (state == OTA_DONE ? doneMs : lastDataMs) - startMs;
+            doc["elapsed_ms"] = elapsed;
+            doc["kbps"] = elapsed ? (uint32_t)((uint64_t)received * 8 / elapsed) : 0;
+        }
+        if (*error)
+            doc["error"] = error;
+        return serializeJson(doc, buf, cap);
+    }
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// 空中升级：镜像按块（WebSocket 二进制帧或 HTTP 分段上传）直接写入未运行的 OTA 分区，
+// 边写边计算 SHA-256，内存占用与镜像大小无关；全部写完后先比对哈希并校验镜像，再切换启动分区并重启
+namespace OtaUpdate
+{
+    enum State : uint8_t
+    {
+        OTA_IDLE,
+        OTA_RECEIVING,
+        OTA_DONE, // 已切换启动分区，稍后重启
+        OTA_ERROR
+    };
+
+    // size 为 0 表示大小未知（只能由 finish 结束）；sha256 为 64 位十六进制串
+    bool begin(uint32_t size, const char *sha256Hex);
+    // offset 必须等于已接收字节数，否则拒绝（客户端据此从 getReceived() 处续传）；
+    // 大小已知时收满即自动 finish
+    bool write(uint32_t offset, const uint8_t *data, size_t len);
+    bool finish();
+    void abort(const char *reason);
+    // 超时检测与成功后的延迟重启
+    void loop();
+
+    State getState();
+    const char *getStateStr();
+    const char *getError();
+    uint32_t getReceived();
+    uint32_t getTotal();
+
+    // evt 为 ota 的进度 JSON（含吞吐量）
+    size_t writeJson(char *buf, size_t cap);
+}
@@ -0,0 +1,83 @@
+#include "profiler.h"
+
+#ifdef LOOP_PROFILER
+#include <ArduinoJson.h>
+#include <algorithm>
+
+namespace Profiler
+{
+    struct Window
+    {
+        uint32_t samples[WINDOW];
+        uint32_t count; // 累计样本数（环形写入位置 = count % WINDOW）
+    };
+
+    static const char *const sectionNames[SEC_COUNT] = {
+        "network",
+        "led",
+        "ws",
+        "broadcast",
+        "loop",
+    };
+
+    static Window windows[SEC_COUNT];
+    static uint32_t budgetCycles = 0;
+    static uint32_t overBudget = 0;
+
+    void begin(uint32_t loopBudgetUs)
+    {
+        budgetCycles = loopBudgetUs * ESP.getCpuFreqMHz();
+        reset();
+    }
+
+    void record(Section s, uint32_t cycles)
+    {
+        Window &w = windows[s];
+        w.samples[w.count % WINDOW] = cycles;
+        w.count++;
+        if (s == SEC_LOOP && cycles > budgetCycles)
+            overBudget++;
+    }
+
+    void reset()
+    {
+        memset(windows, 0, sizeof(windows));
+        overBudget = 0;
+    }
+
+    size_t writeJson(char *buf, size_t cap, bool doReset)
+    {
+        static StaticJsonDocument<768> doc;
+        // 排序用的临时副本，放在静态区避免占用 loop 任务栈
+        static uint32_t sorted[WINDOW];
+        doc.clear();
+        uint32_t mhz = ESP.getCpuFreqMHz();
+        doc["evt"] = "profile";
+        doc["budget_us"] = budgetCycles / mhz;
+        doc["over_budget"] = overBudget;
+        JsonObject secs = doc.createNestedObject("sections");
+        for (int s = 0; s < SEC_COUNT; ++s)
+        {
+            const Window &w = windows[s];
+            int n = w.count < (uint32_t)WINDOW ? (int)w.count : WINDOW;
+            JsonObject o = secs.createNestedObject(sectionNames[s]);
+            o["n"] = w.count;
+            if (n == 0)
+                continue;
+            memcpy(sorted, w.samples, n * sizeof(uint32_t));
+            std::sort(sorted, sorted + n);
+            uint64_t sum = 0;
+            for (int i = 0; i < n; ++i)
+                sum += sorted[i];
+            o["min"] = sorted[0] / mhz;
+            o["avg"] = (uint32_t)(sum / n / mhz);
+            o["max"] = sorted[n - 1] / mhz;
+            o["p99"] = sorted[(n * 99) / 100] / mhz;
+        }
+        size_t len = serializeJson(doc, buf, cap);
+        if (doReset)
+            reset();
+        return len;
+    }
+}
+#endif
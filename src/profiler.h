@@ -0,0 +1,48 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// 基于 CPU 周期计数器的分段循环剖析器
+// 在 platformio.ini 的 build_flags 中加入 -DLOOP_PROFILER 启用；未启用时 PROFILE_SCOPE 展开为空，不产生任何代码
+#ifdef LOOP_PROFILER
+#include <Arduino.h>
+
+namespace Profiler
+{
+    enum Section
+    {
+        SEC_NETWORK,
+        SEC_LED,
+        SEC_WS,
+        SEC_BROADCAST,
+        SEC_LOOP,
+        SEC_COUNT
+    };
+
+    // 每段保留最近 WINDOW 次样本用于计算 min/avg/max/p99
+    constexpr int WINDOW = 128;
+
+    // loopBudgetUs：单次 loop 的时间预算，超出则计入 over_budget
+    void begin(uint32_t loopBudgetUs);
+    void record(Section s, uint32_t cycles);
+    void reset();
+    // 输出 JSON（单位：微秒）；reset 为 true 时输出后清空统计
+    size_t writeJson(char *buf, size_t cap, bool reset);
+
+    // 作用域计时：构造时读取周期计数，析构时记录差值
+    struct Scope
+    {
+        Section section;
+        uint32_t start;
+        explicit Scope(Section s) : section(s), start(ESP.getCycleCount()) {}
+        ~Scope() { record(section, ESP.getCycleCount() - start); }
+    };
+}
+
+#define PROFILE_SCOPE(sec) Profiler::Scope profilerScope_(Profiler::sec)
+#else
+#define PROFILE_SCOPE(sec) \
+    do                     \
+    {                      \
+    } while (0)
+#endif
@@ -0,0 +1,502 @@
+#include "scheduler.h"
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "led_controller.h"
+#include "status_reporter.h"
+#include "storage.h"
+#include "log.h"
+
+namespace Scheduler
+{
+    // 时间轮：第 l 层每槽跨度 64^l 秒，共覆盖 2^24 秒（约 194 天）；更远的规则先挂在最高层，逐层下沉
+    constexpr int LEVELS = 4;
+    constexpr int SLOT_BITS = 6;
+    constexpr int SLOTS = 1 << SLOT_BITS;
+    constexpr uint32_t SLOT_MASK = SLOTS - 1;
+    constexpr uint32_t MAX_DELTA = (1u << (SLOT_BITS * LEVELS)) - 1;
+    constexpr uint32_t SECONDS_PER_DAY = 86400;
+    // 单次 loop 最多补走的秒数，长时间阻塞后分多次追上，避免一次 loop 过长
+    constexpr int MAX_CATCHUP_TICKS = 16;
+
+    struct Entry
+    {
+        Rule rule;
+        bool used;
+        bool armed;
+        uint32_t expire; // 到期时刻（时间轮秒）
+        int8_t next;     // 槽内双向链表，-1 表示无
+        int8_t prev;
+        int8_t level;
+        uint8_t slot;
+    };
+
+    struct Scene
+    {
+        bool valid;
+        char mode[8];
+        uint16_t hz;
+        uint16_t periodMs;
+        uint8_t brightness;
+    };
+
+    static Entry pool[MAX_RULES];
+    static Scene scenes[MAX_SCENES];
+    static int8_t wheel[LEVELS][SLOTS];
+    static uint32_t wheelNow = 0; // 启动以来的秒数，由 millis 累加，不受 millis 回绕影响
+    static unsigned long lastMs = 0;
+    static uint32_t accMs = 0;
+    static int armedCount = 0;
+    static uint32_t fired = 0;
+
+    static bool timeSet = false;
+    static uint32_t epochAtSet = 0;
+    static uint32_t wheelAtSet = 0;
+    static int tzOffsetMin = 0;
+
+    // 文档按规则与场景数的上限分配：顶层 6 个成员，每条规则最多 10 个（含 armed / in_s），每个场景 5 个；
+    // 另留读取文件时复制字符串（模式名等）的空间。持久化与列表共用，读写都只在 loop 任务中进行
+    constexpr size_t DOC_CAPACITY = JSON_OBJECT_SIZE(6) +
+                                    JSON_ARRAY_SIZE(MAX_RULES) + MAX_RULES * JSON_OBJECT_SIZE(10) +
+                                    JSON_ARRAY_SIZE(MAX_SCENES) + MAX_SCENES * JSON_OBJECT_SIZE(5) + 512;
+    // 列表文本上限：每条规则最长约 150 字节（mode 动作、各字段取最大值），每个场景约 75 字节
+    constexpr size_t LIST_CAPACITY = MAX_RULES * 160 + MAX_SCENES * 80 + 128;
+    static StaticJsonDocument<DOC_CAPACITY> doc;
+    static char listBuf[LIST_CAPACITY];
+
+    static const char *const REPEAT_NAMES[] = {"once", "daily", "every"};
+    static const char *const ACTION_NAMES[] = {"mode", "brightness", "scene"};
+
+    static void link(int i)
+    {
+        Entry &e = pool[i];
+        // 下沉时可能恰好在本秒到期：落在第 0 层当前槽，紧接着在本次 tick 中触发
+        if ((int32_t)(e.expire - wheelNow) < 0)
+            e.expire = wheelNow;
+        uint32_t delta = e.expire - wheelNow;
+        uint32_t target = e.expire;
+        if (delta > MAX_DELTA)
+            target = wheelNow + MAX_DELTA;
+        int level = 0;
+        while (level < LEVELS - 1 && (target - wheelNow) >= (1u << (SLOT_BITS * (level + 1))))
+            level++;
+        uint8_t slot = (uint8_t)((target >> (SLOT_BITS * level)) & SLOT_MASK);
+        e.level = (int8_t)level;
+        e.slot = slot;
+        e.prev = -1;
+        e.next = wheel[level][slot];
+        if (e.next >= 0)
+            pool[e.next].prev = (int8_t)i;
+        wheel[level][slot] = (int8_t)i;
+        if (!e.armed)
+        {
+            e.armed = true;
+            armedCount++;
+        }
+    }
+
+    static void unlink(int i)
+    {
+        Entry &e = pool[i];
+        if (!e.armed)
+            return;
+        if (e.prev >= 0)
+            pool[e.prev].next = e.next;
+        else
+            wheel[e.level][e.slot] = e.next;
+        if (e.next >= 0)
+            pool[e.next].prev = e.prev;
+        e.armed = false;
+        armedCount--;
+    }
+
+    static uint32_t epochNow()
+    {
+        return epochAtSet + (wheelNow - wheelAtSet);
+    }
+
+    // 计算规则下一次的到期时刻并挂上时间轮；时间未设置或已过期的一次性规则不挂
+    static void arm(int i)
+    {
+        Entry &e = pool[i];
+        const Rule &r = e.rule;
+        switch (r.repeat)
+        {
+        case REPEAT_EVERY:
+            e.expire = wheelNow + max<uint32_t>(1, r.at);
+            break;
+        case REPEAT_DAILY:
+        {
+            if (!timeSet)
+                return;
+            uint32_t local = epochNow() + (int32_t)tzOffsetMin * 60;
+            uint32_t sod = local % SECONDS_PER_DAY;
+            uint32_t delta = (r.at + SECONDS_PER_DAY - sod) % SECONDS_PER_DAY;
+            e.expire = wheelNow + (delta ? delta : SECONDS_PER_DAY);
+            break;
+        }
+        case REPEAT_ONCE:
+        default:
+            if (!timeSet || (int32_t)(r.at - epochNow()) <= 0)
+                return;
+            e.expire = wheelNow + (r.at - epochNow());
+            break;
+        }
+        link(i);
+    }
+
+    // 把规则与场景填入 doc；runtime 为 true 时附带只对列表有意义的运行状态（不写入 /schedule.json）
+    static void buildDoc(bool runtime)
+    {
+        doc.clear();
+        if (runtime)
+        {
+            doc["evt"] = "schedule";
+            doc["time_set"] = timeSet;
+            doc["epoch"] = getEpoch();
+            doc["tz_min"] = tzOffsetMin;
+        }
+        JsonArray rules = doc.createNestedArray("rules");
+        for (int i = 0; i < MAX_RULES; ++i)
+        {
+            const Entry &e = pool[i];
+            if (!e.used)
+                continue;
+            const Rule &r = e.rule;
+            JsonObject o = rules.createNestedObject();
+            o["id"] = i;
+            o["repeat"] = REPEAT_NAMES[r.repeat];
+            o["at"] = r.at;
+            o["action"] = ACTION_NAMES[r.action];
+            if (r.action == ACT_MODE)
+            {
+                o["mode"] = (const char *)r.mode;
+                o["hz"] = r.hz;
+                o["period_ms"] = r.periodMs;
+            }
+            else if (r.action == ACT_BRIGHTNESS)
+                o["duty"] = r.duty;
+            else
+                o["scene"] = r.scene;
+            if (r.fadeMs)
+                o["fade_ms"] = r.fadeMs;
+            if (runtime)
+            {
+                o["armed"] = e.armed;
+                if (e.armed)
+                    o["in_s"] = e.expire - wheelNow;
+            }
+        }
+        JsonArray sc = doc.createNestedArray("scenes");
+        for (int i = 0; i < MAX_SCENES; ++i)
+        {
+            const Scene &s = scenes[i];
+            if (!s.valid)
+                continue;
+            JsonObject o = sc.createNestedObject();
+            o["slot"] = i;
+            o["mode"] = (const char *)s.mode;
+            o["hz"] = s.hz;
+            o["period_ms"] = s.periodMs;
+            o["brightness"] = s.brightness;
+        }
+    }
+
+    static void save()
+    {
+        buildDoc(false);
+        Storage::saveSchedule(doc);
+    }
+
+    static bool applyMode(const char *mode, int hz, int periodMs)
+    {
+        if (strcmp(mode, "on") == 0)
+            LedController::setModeOn();
+        else if (strcmp(mode, "off") == 0)
+            LedController::setModeOff();
+        else if (strcmp(mode, "blink") == 0)
+            LedController::setModeBlink(max(1, hz));
+        else if (strcmp(mode, "breathe") == 0)
+            LedController::setModeBreathe(max(200, periodMs));
+        else if (strcmp(mode, "audio") == 0)
+            LedController::setModeAudio();
+        else
+            return false;
+        return true;
+    }
+
+    static void applyBrightness(uint8_t duty, uint32_t fadeMs)
+    {
+        if (fadeMs > 0)
+            LedController::fadeBrightness(duty, fadeMs);
+        else
+            LedController::setBrightness(duty);
+    }
+
+    static void execute(const Rule &r)
+    {
+        // 推流期间由客户端独占 LED，跳过定时动作
+        if (LedController::isStreaming())
+            return;
+        switch (r.action)
+        {
+        case ACT_MODE:
+            applyMode(r.mode, r.hz, r.periodMs);
+            break;
+        case ACT_BRIGHTNESS:
+            applyBrightness(r.duty, r.fadeMs);
+            break;
+        case ACT_SCENE:
+        {
+            if (r.scene >= MAX_SCENES || !scenes[r.scene].valid)
+                return;
+            const Scene &s = scenes[r.scene];
+            applyMode(s.mode, s.hz, s.periodMs);
+            applyBrightness(s.brightness, r.fadeMs);
+            break;
+        }
+        }
+        Storage::saveState();
+        StatusReporter::broadcast();
+    }
+
+    // 第 l 层的当前槽在低 6*l 位归零时整体重新挂到更低层；低层槽索引回到 0 时才继续下沉更高一层
+    static void cascade(int level)
+    {
+        uint8_t slot = (uint8_t)((wheelNow >> (SLOT_BITS * level)) & SLOT_MASK);
+        int8_t i = wheel[level][slot];
+        wheel[level][slot] = -1;
+        while (i >= 0)
+        {
+            int8_t next = pool[i].next;
+            pool[i].armed = false;
+            armedCount--;
+            link(i);
+            i = next;
+        }
+    }
+
+    static void tick()
+    {
+        wheelNow++;
+        for (int level = 1; level < LEVELS; ++level)
+        {
+            if (wheelNow & ((1u << (SLOT_BITS * level)) - 1))
+                break;
+            cascade(level);
+        }
+
+        bool dirty = false;
+        uint8_t slot = (uint8_t)(wheelNow & SLOT_MASK);
+        int8_t i = wheel[0][slot];
+        wheel[0][slot] = -1;
+        while (i >= 0)
+        {
+            Entry &e = pool[i];
+            int8_t next = e.next;
+            e.armed = false;
+            armedCount--;
+            if ((int32_t)(e.expire - wheelNow) > 0)
+            {
+                // 超出时间轮范围的远期规则：尚未到期，继续下沉
+                link(i);
+                i = next;
+                continue;
+            }
+            fired++;
+            execute(e.rule);
+            if (e.rule.repeat == REPEAT_EVERY)
+            {
+                e.expire += max<uint32_t>(1, e.rule.at);
+                link(i);
+            }
+            else if (e.rule.repeat == REPEAT_DAILY)
+            {
+                e.expire += SECONDS_PER_DAY;
+                link(i);
+            }
+            else
+            {
+                e.used = false;
+                dirty = true;
+            }
+            i = next;
+        }
+        if (dirty)
+            save();
+    }
+
+    static bool ruleFromJson(JsonObjectConst o, Rule &r)
+    {
+        memset(&r, 0, sizeof(r));
+        const char *repeat = o["repeat"] | "";
+        const char *action = o["action"] | "";
+        int ri = -1, ai = -1;
+        for (int k = 0; k < 3; ++k)
+        {
+            if (strcmp(repeat, REPEAT_NAMES[k]) == 0)
+                ri = k;
+            if (strcmp(action, ACTION_NAMES[k]) == 0)
+                ai = k;
+        }
+        if (ri < 0 || ai < 0)
+            return false;
+        r.repeat = (Repeat)ri;
+        r.action = (ActionType)ai;
+        r.at = o["at"] | 0u;
+        strlcpy(r.mode, o["mode"] | "", sizeof(r.mode));
+        r.hz = o["hz"] | 0;
+        r.periodMs = o["period_ms"] | 0;
+        r.duty = o["duty"] | 0;
+        r.scene = o["scene"] | 0;
+        r.fadeMs = o["fade_ms"] | 0u;
+        return true;
+    }
+
+    void begin()
+    {
+        memset(pool, 0, sizeof(pool));
+        memset(scenes, 0, sizeof(scenes));
+        memset(wheel, -1, sizeof(wheel));
+        wheelNow = 0;
+        accMs = 0;
+        lastMs = millis();
+        armedCount = 0;
+        timeSet = false;
+
+        if (!Storage::loadSchedule(doc))
+            return;
+        for (JsonObjectConst o : doc["rules"].as<JsonArrayConst>())
+        {
+            int id = o["id"] | -1;
+            if (id < 0 || id >= MAX_RULES || pool[id].used)
+                continue;
+            if (!ruleFromJson(o, pool[id].rule))
+                continue;
+            pool[id].used = true;
+            arm(id);
+        }
+        for (JsonObjectConst o : doc["scenes"].as<JsonArrayConst>())
+        {
+            int slot = o["slot"] | -1;
+            if (slot < 0 || slot >= MAX_SCENES)
+                continue;
+            Scene &s = scenes[slot];
+            s.valid = true;
+            strlcpy(s.mode, o["mode"] | "breathe", sizeof(s.mode));
+            s.hz = o["hz"] | 2;
+            s.periodMs = o["period_ms"] | 1500;
+            s.brightness = o["brightness"] | 128;
+        }
+        Log::write(Log::SCHED_LOADED, (int)doc["rules"].size(), armedCount);
+    }
+
+    void loop()
+    {
+        unsigned long now = millis();
+        accMs += now - lastMs;
+        lastMs = now;
+        for (int n = 0; accMs >= 1000 && n < MAX_CATCHUP_TICKS; ++n)
+        {
+            accMs -= 1000;
+            tick();
+        }
+    }
+
+    int add(const Rule &rule)
+    {
+        for (int i = 0; i < MAX_RULES; ++i)
+        {
+            if (pool[i].used)
+                continue;
+            pool[i].rule = rule;
+            pool[i].used = true;
+            pool[i].armed = false;
+            arm(i);
+            save();
+            return i;
+        }
+        return -1;
+    }
+
+    bool remove(int id)
+    {
+        if (id < 0 || id >= MAX_RULES || !pool[id].used)
+            return false;
+        unlink(id);
+        pool[id].used = false;
+        save();
+        return true;
+    }
+
+    void clear()
+    {
+        for (int i = 0; i < MAX_RULES; ++i)
+        {
+            unlink(i);
+            pool[i].used = false;
+        }
+        save();
+    }
+
+    bool saveScene(int slot)
+    {
+        if (slot < 0 || slot >= MAX_SCENES || LedController::isStreaming())
+            return false;
+        Scene &s = scenes[slot];
+        s.valid = true;
+        strlcpy(s.mode, LedController::getModeStr(), sizeof(s.mode));
+        s.hz = (uint16_t)LedController::getBlinkHz();
+        s.periodMs = (uint16_t)LedController::getBreathePeriod();
+        s.brightness = LedController::getBrightness();
+        save();
+        return true;
+    }
+
+    void setTime(uint32_t epoch, int tzOffset)
+    {
+        epochAtSet = epoch;
+        wheelAtSet = wheelNow;
+        tzOffsetMin = tzOffset;
+        timeSet = true;
+        // 时间基准变化只影响 once/daily 规则，重新计算它们的到期时刻
+        for (int i = 0; i < MAX_RULES; ++i)
+        {
+            if (!pool[i].used || pool[i].rule.repeat == REPEAT_EVERY)
+                continue;
+            unlink(i);
+            arm(i);
+        }
+    }
+
+    bool isTimeSet()
+    {
+        return timeSet;
+    }
+
+    uint32_t getEpoch()
+    {
+        return timeSet ? epochNow() : 0;
+    }
+
+    int getTzOffsetMin()
+    {
+        return tzOffsetMin;
+    }
+
+    int getArmedCount()
+    {
+        return armedCount;
+    }
+
+    uint32_t getFired()
+    {
+        return fired;
+    }
+
+    const char *listJson(size_t &len)
+    {
+        buildDoc(true);
+        len = serializeJson(doc, listBuf, sizeof(listBuf));
+        return listBuf;
+    }
+}
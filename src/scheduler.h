@@ -0,0 +1,66 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// 设备端定时任务：一次性 / 每日定时 / 固定间隔的 LED 动作
+// 规则挂在分层时间轮上（1 s 一格，4 层 × 64 槽），插入、取消、触发都是 O(1)，每秒推进时不扫描规则表
+// 规则与场景通过 Storage 持久化到 /schedule.json；没有客户端连接时照常执行
+namespace Scheduler
+{
+    enum Repeat : uint8_t
+    {
+        REPEAT_ONCE,  // at = epoch 秒
+        REPEAT_DAILY, // at = 本地时间的当日秒数（0..86399）
+        REPEAT_EVERY  // at = 间隔秒数，从添加（或启动）时开始计时
+    };
+
+    enum ActionType : uint8_t
+    {
+        ACT_MODE,       // 切换模式（mode/hz/periodMs）
+        ACT_BRIGHTNESS, // 设置亮度，fadeMs > 0 时渐变
+        ACT_SCENE       // 恢复场景（完整的模式 + 参数 + 亮度快照），fadeMs 作用于亮度
+    };
+
+    struct Rule
+    {
+        Repeat repeat;
+        uint32_t at;
+        ActionType action;
+        char mode[8];
+        uint16_t hz;
+        uint16_t periodMs;
+        uint8_t duty;
+        uint8_t scene;
+        uint32_t fadeMs;
+    };
+
+    constexpr int MAX_RULES = 32;
+    constexpr int MAX_SCENES = 8;
+
+    // 从 Storage 加载规则与场景
+    void begin();
+    // 按 millis() 推进时间轮并执行到期动作
+    void loop();
+
+    // 返回规则 id（0..MAX_RULES-1），池满返回 -1；add/remove/saveScene 会立即持久化
+    int add(const Rule &rule);
+    bool remove(int id);
+    void clear();
+    // 将当前 LED 状态保存为场景
+    bool saveScene(int slot);
+
+    // 设备没有 RTC，也无法在 SoftAP 上使用 NTP，由客户端下发当前时间；
+    // 设置后 once/daily 规则才会挂上时间轮
+    void setTime(uint32_t epoch, int tzOffsetMin);
+    bool isTimeSet();
+    uint32_t getEpoch();
+    int getTzOffsetMin();
+
+    // 已挂上时间轮（会触发）的规则数
+    int getArmedCount();
+    uint32_t getFired();
+
+    // 规则与场景的 JSON（evt 为 schedule），附带时间与各规则的运行状态（armed / in_s）；
+    // 返回内部缓冲，下次调用前有效
+    const char *listJson(size_t &len);
+}
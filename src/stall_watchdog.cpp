@@ -0,0 +1,164 @@
+#include "stall_watchdog.h"
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <soc/soc_memory_layout.h>
+#if CONFIG_IDF_TARGET_ARCH_RISCV
+#include <riscv/rvruntime-frames.h>
+#endif
+
+namespace StallWatchdog
+{
+    constexpr uint32_t LOG_MAGIC = 0x5354414C; // "STAL"
+    // 看门狗任务的轮询间隔（ms）
+    constexpr uint32_t POLL_MS = 50;
+    // 回溯扫描的最大栈深度（字）
+    constexpr int SCAN_WORDS = 256;
+
+    struct StallLog
+    {
+        uint32_t magic;
+        uint32_t boot;
+        uint32_t nextSeq;
+        uint32_t count; // 累计记录数（环形写入位置 = count % MAX_RECORDS）
+        StallRecord records[MAX_RECORDS];
+    };
+
+    // RTC_NOINIT_ATTR：软复位时不清零，上电时内容随机，需用 magic 校验
+    static RTC_NOINIT_ATTR StallLog stallLog;
+
+    static TaskHandle_t mainTask = nullptr;
+    static uint32_t threshold = 500;
+    static volatile uint32_t lastFeedMs = 0;
+    static volatile uint32_t feedCount = 0;
+    // 已为哪次心跳记录过卡顿，避免同一次卡顿被重复记录
+    static uint32_t reportedFeed = UINT32_MAX;
+
+    // 采样被挂起的主任务：RISC-V 移植在任务切出时把完整寄存器帧（RvExcFrame）压在任务栈顶，
+    // TCB 的第一个成员 pxTopOfStack 指向该帧
+    static void capture(StallRecord &r)
+    {
+        r.pc = r.ra = r.sp = 0;
+        r.depth = 0;
+#if CONFIG_IDF_TARGET_ARCH_RISCV
+        const RvExcFrame *frame = *(const RvExcFrame *const *)mainTask;
+        if (!esp_ptr_in_dram(frame))
+            return;
+        r.pc = frame->mepc;
+        r.ra = frame->ra;
+        r.sp = frame->sp;
+        // 没有帧指针时无法精确回溯：沿栈向上扫描，收集指向可执行区的值作为候选返回地址
+        const uint32_t *p = (const uint32_t *)(uintptr_t)r.sp;
+        for (int i = 0; i < SCAN_WORDS && r.depth < BT_DEPTH; ++i, ++p)
+        {
+            if (!esp_ptr_in_dram(p))
+                break;
+            uint32_t v = *p;
+            if (v != r.ra && esp_ptr_executable((void *)(uintptr_t)v))
+                r.backtrace[r.depth++] = v;
+        }
+#endif
+    }
+
+    static void record(uint32_t now, uint32_t stalledMs)
+    {
+        StallRecord &r = stallLog.records[stallLog.count % MAX_RECORDS];
+        r.seq = stallLog.nextSeq++;
+        r.boot = stallLog.boot;
+        r.uptimeMs = now;
+        r.stalledMs = stalledMs;
+        // 挂起主任务以读取稳定的寄存器帧，采样完立即恢复
+        vTaskSuspend(mainTask);
+        capture(r);
+        vTaskResume(mainTask);
+        stallLog.count++;
+    }
+
+    static void watchdogTask(void *)
+    {
+        for (;;)
+        {
+            vTaskDelay(pdMS_TO_TICKS(POLL_MS));
+            uint32_t now = millis();
+            uint32_t fed = feedCount;
+            uint32_t stalled = now - lastFeedMs;
+            if (stalled > threshold && fed != reportedFeed)
+            {
+                reportedFeed = fed;
+                record(now, stalled);
+            }
+        }
+    }
+
+    void begin(uint32_t thresholdMs)
+    {
+        if (stallLog.magic != LOG_MAGIC)
+        {
+            memset(&stallLog, 0, sizeof(stallLog));
+            stallLog.magic = LOG_MAGIC;
+        }
+        stallLog.boot++;
+        if (stallLog.count > 0)
+            Serial.printf("StallWatchdog: %u stall record(s) from previous runs\n", (unsigned)stallLog.count);
+
+        threshold = thresholdMs;
+        mainTask = xTaskGetCurrentTaskHandle();
+        lastFeedMs = millis();
+        // 与 loop 任务同优先级（1）：loop 忙等时靠时间片轮转获得运行机会，loop 阻塞时立即运行
+        xTaskCreate(watchdogTask, "stall_wd", 2048, nullptr, 1, nullptr);
+    }
+
+    void feed()
+    {
+        lastFeedMs = millis();
+        feedCount++;
+    }
+
+    int getCount()
+    {
+        return (int)stallLog.count;
+    }
+
+    void clear()
+    {
+        stallLog.count = 0;
+    }
+
+    size_t writeJson(char *buf, size_t cap)
+    {
+        static StaticJsonDocument<4096> doc;
+        doc.clear();
+        doc["evt"] = "stalls";
+        doc["boot"] = stallLog.boot;
+        doc["threshold_ms"] = threshold;
+        doc["count"] = stallLog.count;
+        JsonArray arr = doc.createNestedArray("records");
+        uint32_t n = stallLog.count < (uint32_t)MAX_RECORDS ? stallLog.count : MAX_RECORDS;
+        // 按时间顺序输出（最旧的在前）
+        for (uint32_t i = stallLog.count - n; i < stallLog.count; ++i)
+        {
+            const StallRecord &r = stallLog.records[i % MAX_RECORDS];
+            JsonObject o = arr.createNestedObject();
+            char hex[11];
+            o["seq"] = r.seq;
+            o["boot"] = r.boot;
+            o["uptime_ms"] = r.uptimeMs;
+            o["stalled_ms"] = r.stalledMs;
+            // 地址以十六进制字符串输出，便于直接交给 addr2line
+            snprintf(hex, sizeof(hex), "0x%08lx", (unsigned long)r.pc);
+            o["pc"] = hex;
+            snprintf(hex, sizeof(hex), "0x%08lx", (unsigned long)r.ra);
+            o["ra"] = hex;
+            snprintf(hex, sizeof(hex), "0x%08lx", (unsigned long)r.sp);
+            o["sp"] = hex;
+            JsonArray bt = o.createNestedArray("bt");
+            for (int k = 0; k < r.depth && k < BT_DEPTH; ++k)
+            {
+                snprintf(hex, sizeof(hex), "0x%08lx", (unsigned long)r.backtrace[k]);
+                bt.add(hex);
+            }
+        }
+        return serializeJson(doc, buf, cap);
+    }
+}
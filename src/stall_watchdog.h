@@ -0,0 +1,32 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// loop 卡顿看门狗：低优先级任务监视 loop 的心跳，超时则采样主任务的 PC 与回溯
+// 记录保存在 RTC 内存的环形缓冲中，软复位（含 panic / 看门狗复位）后仍可读取
+namespace StallWatchdog
+{
+    constexpr int MAX_RECORDS = 8;
+    constexpr int BT_DEPTH = 8;
+
+    struct StallRecord
+    {
+        uint32_t seq;        // 全局递增序号（跨复位）
+        uint32_t boot;       // 发生时的启动次数
+        uint32_t uptimeMs;   // 发生时的运行时长
+        uint32_t stalledMs;  // 检测时 loop 已停滞的时长
+        uint32_t pc;         // 主任务被切出时的程序计数器
+        uint32_t ra;         // 返回地址寄存器
+        uint32_t sp;         // 栈指针
+        uint32_t backtrace[BT_DEPTH]; // 栈上扫描到的疑似返回地址（启发式）
+        uint8_t depth;
+    };
+
+    // 必须在 loop 任务中调用（记录当前任务作为被监视的主任务）
+    void begin(uint32_t thresholdMs);
+    // 每完成一次 loop 迭代调用一次
+    void feed();
+    int getCount();
+    void clear();
+    size_t writeJson(char *buf, size_t cap);
+}
@@ -2,6 +2,10 @@
 #include "led_controller.h"
 #include "network.h"
 #include "websocket_handler.h"
+#include "metrics.h"
+#include "audio_input.h"
+#include "event_log.h"
+#include "msg_pool.h"
 #include <ArduinoJson.h>
 #include <WiFi.h>
 #include "esp_wifi.h"
@@ -9,22 +13,24 @@
 
 static unsigned long startMillis = 0;
 
+// 预分配的状态快照缓冲：broadcast 与 sendTo 共用，只有输入变化时才重建
+static char snapshot[320];
+static size_t snapshotLen = 0;
+static uint32_t snapshotVersion = 0;
+static bool snapshotValid = false;
+// 构建快照时所依据的输入版本
+static uint32_t counterVersion = 0;
+static uint32_t builtCounterVersion = 0;
+static uint32_t builtLedVersion = 0;
+static unsigned long builtUptime = 0;
+
 namespace StatusReporter
 {
-    void begin()
-    {
-        // 记录启动时间用于 uptime 计算
-        startMillis = millis();
-    }
-
-    void broadcast()
-    {
-        StaticJsonDocument<256> doc;
-        doc["evt"] = "status";
-        doc["uptime"] = (unsigned long)((millis() - startMillis) / 1000);
     // 计算 RSSI：
     // - 如果有 SoftAP 客户端，尝试通过 esp_wifi_ap_get_sta_list() 获取客户端的 RSSI
     // - 否则如果作为 STA 连接，则使用 WiFi.RSSI()
+    static int readRssi()
+    {
         int rssiVal = 0;
         if (WiFi.softAPgetStationNum() > 0)
         {
@@ -46,65 +52,91 @@ namespace StatusReporter
         {
             rssiVal = WiFi.RSSI();
         }
-        doc["rssi"] = rssiVal;
-        doc["mode"] = LedController::getModeStr();
-        doc["hz"] = LedController::getBlinkHz();
-        doc["period_ms"] = LedController::getBreathePeriod();
-    doc["brightness"] = LedController::getBrightness();
-    doc["dropped"] = WebsocketHandler::getDropped();
-        doc["wifi_clients"] = WiFi.softAPgetStationNum();
-        doc["ws_clients"] = WebsocketHandler::getConnectedCount();
-
-        String out;
-        serializeJson(doc, out);
-        WebsocketHandler::broadcastText(out);
+        return rssiVal;
     }
 
-    void sendTo(int clientNum)
+    // 返回最新的快照；LED 状态、计数器与 uptime（秒）都未变化时直接复用上次的结果
+    static const char *buildSnapshot(size_t &len)
     {
-        StaticJsonDocument<256> doc;
-        doc["evt"] = "status";
-        doc["uptime"] = (unsigned long)((millis() - startMillis) / 1000);
-        int rssiVal = 0;
-        if (WiFi.softAPgetStationNum() > 0)
+        unsigned long uptime = (millis() - startMillis) / 1000;
+        uint32_t ledVersion = LedController::getStateVersion();
+        if (!snapshotValid || ledVersion != builtLedVersion || counterVersion != builtCounterVersion || uptime != builtUptime)
         {
-            wifi_sta_list_t sta_list;
-            if (esp_wifi_ap_get_sta_list(&sta_list) == ESP_OK && sta_list.num > 0)
-            {
-                int best = INT_MIN;
-                for (int i = 0; i < (int)sta_list.num; ++i)
-                {
-                    wifi_sta_info_t info = sta_list.sta[i];
-                    if ((int)info.rssi > best)
-                        best = (int)info.rssi;
-                }
-                if (best != INT_MIN)
-                    rssiVal = best;
-            }
-        }
-        else if (WiFi.status() == WL_CONNECTED)
-        {
-            rssiVal = WiFi.RSSI();
+            snapshotVersion++;
+            StaticJsonDocument<256> doc;
+            doc["evt"] = "status";
+            doc["ver"] = snapshotVersion;
+            doc["uptime"] = uptime;
+            doc["rssi"] = readRssi();
+            doc["mode"] = LedController::getModeStr();
+            doc["hz"] = LedController::getBlinkHz();
+            doc["period_ms"] = LedController::getBreathePeriod();
+            doc["brightness"] = LedController::getBrightness();
+            // 启用中的覆盖层（位掩码：1 空闲呼吸，2 通知，4 亮度上限）与亮度上限
+            doc["layers"] = LedController::getActiveLayers();
+            doc["limit"] = LedController::getLimit();
+            doc["dropped"] = WebsocketHandler::getDropped();
+            doc["wifi_clients"] = WiFi.softAPgetStationNum();
+            doc["ws_clients"] = WebsocketHandler::getConnectedCount();
+            // 每块 DSP 平均耗时，随 uptime 秒级刷新，不单独触发重建
+            doc["audio_us"] = AudioInput::getAvgCostUs();
+
+            snapshotLen = serializeJson(doc, snapshot, sizeof(snapshot));
+            builtLedVersion = ledVersion;
+            builtCounterVersion = counterVersion;
+            builtUptime = uptime;
+            snapshotValid = true;
         }
-        doc["rssi"] = rssiVal;
-        doc["mode"] = LedController::getModeStr();
-        doc["hz"] = LedController::getBlinkHz();
-        doc["period_ms"] = LedController::getBreathePeriod();
-    doc["brightness"] = LedController::getBrightness();
-    doc["dropped"] = WebsocketHandler::getDropped();
-    doc["wifi_clients"] = WiFi.softAPgetStationNum();
-        doc["ws_clients"] = WebsocketHandler::getConnectedCount();
+        len = snapshotLen;
+        return snapshot;
+    }
 
-        String out;
-        serializeJson(doc, out);
-        // 发送到指定客户端
+    void begin()
+    {
+        // 记录启动时间用于 uptime 计算
+        startMillis = millis();
+        snapshotValid = false;
+    }
+
+    void broadcast()
+    {
+        // 流式播放期间不广播，避免与播放争用 CPU 与带宽
+        if (LedController::isStreaming())
+            return;
+        size_t len;
+        const char *s = buildSnapshot(len);
+        WebsocketHandler::broadcastText(s, len, true);
+    }
+
+    void sendTo(int clientNum)
+    {
+        size_t len;
+        const char *s = buildSnapshot(len);
+        // 单发的快照附带当前的事件序号与 epoch，客户端重连时据此 resume
+        MsgPool::Buffer out;
         auto ws = Network::getWebSocketServer();
-        if (ws)
-            ws->sendTXT((uint8_t)clientNum, out);
+        if (!ws || !out)
+            return;
+        size_t slen = EventLog::stampSnapshot(out.data(), out.capacity(), s, len);
+        if (slen == 0)
+            return;
+        // 发送到指定客户端
+        ws->sendTXT((uint8_t)clientNum, out.data(), slen);
+        Metrics::clientOut((uint8_t)clientNum);
     }
 
     void sendTo(uint8_t clientNum)
     {
         sendTo((int)clientNum);
     }
+
+    void invalidate()
+    {
+        counterVersion++;
+    }
+
+    uint32_t getVersion()
+    {
+        return snapshotVersion;
+    }
 }
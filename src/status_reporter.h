@@ -7,4 +7,8 @@ namespace StatusReporter
     void broadcast();
     void sendTo(int clientNum);
     void sendTo(uint8_t clientNum);
+    // 计数器（ws/wifi 客户端数、dropped 等）变化时调用，使缓存的快照失效
+    void invalidate();
+    // 当前快照的版本号（每次重建递增）
+    uint32_t getVersion();
 }
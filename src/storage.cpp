@@ -3,12 +3,19 @@
 #include <ArduinoJson.h>
 #include <Arduino.h>
 #include "led_controller.h"
+#include "group_sync.h"
+#include "metrics.h"
+#include "log.h"
 
 // 内存缓存的保存值
 static char savedMode[16] = "breathe";
 static int savedBlinkHz = 2;
 static int savedBreathePeriod = 1500;
 static uint8_t savedBrightness = 128;
+static uint8_t savedGroupRole = 0;
+static uint8_t savedGroup = 0;
+// stream 模式下有被跳过的保存
+static bool savePending = false;
 
 bool Storage::begin()
 {
@@ -21,8 +28,21 @@ bool Storage::begin()
     return true;
 }
 
+void Storage::flushPending()
+{
+    if (savePending)
+        saveState();
+}
+
 void Storage::saveState()
 {
+    // stream 模式下不写 flash：流是临时状态，结束后会恢复之前的模式；期间的其他改动由 flushPending 补写
+    if (LedController::isStreaming())
+    {
+        savePending = true;
+        return;
+    }
+    savePending = false;
     // 根据当前 LedController 状态构建 JSON
 
     StaticJsonDocument<256> doc;
@@ -30,22 +50,28 @@ void Storage::saveState()
     doc["hz"] = LedController::getBlinkHz();
     doc["period_ms"] = LedController::getBreathePeriod();
     doc["brightness"] = LedController::getBrightness();
+    doc["group_role"] = (uint8_t)GroupSync::getRole();
+    doc["group_id"] = GroupSync::getGroup();
 
+    unsigned long t0 = micros();
     File f = SPIFFS.open("/state.json", FILE_WRITE);
     if (!f)
     {
-        Serial.println("Failed to open state.json for writing");
+        Log::write(Log::STORAGE_OPEN_FAILED);
         return;
     }
-    serializeJson(doc, f);
+    size_t bytes = serializeJson(doc, f);
     f.close();
+    Metrics::inc(Metrics::CNT_FLASH_WRITES);
     // 更新内存缓存
     strlcpy(savedMode, doc["mode"] | "breathe", sizeof(savedMode));
     savedBlinkHz = doc["hz"] | savedBlinkHz;
     savedBreathePeriod = doc["period_ms"] | savedBreathePeriod;
     savedBrightness = doc["brightness"] | savedBrightness;
+    savedGroupRole = doc["group_role"] | savedGroupRole;
+    savedGroup = doc["group_id"] | savedGroup;
 
-    Serial.println("State saved to /state.json");
+    Log::write(Log::STORAGE_SAVED, bytes, micros() - t0);
 }
 
 void Storage::loadState()
@@ -74,10 +100,47 @@ void Storage::loadState()
     savedBlinkHz = doc["hz"] | savedBlinkHz;
     savedBreathePeriod = doc["period_ms"] | savedBreathePeriod;
     savedBrightness = doc["brightness"] | savedBrightness;
+    savedGroupRole = doc["group_role"] | savedGroupRole;
+    savedGroup = doc["group_id"] | savedGroup;
     Serial.println("Loaded state.json");
 }
 
+void Storage::saveSchedule(const JsonDocument &doc)
+{
+    File f = SPIFFS.open("/schedule.json", FILE_WRITE);
+    if (!f)
+    {
+        Log::write(Log::STORAGE_SCHEDULE_OPEN_FAILED);
+        return;
+    }
+    serializeJson(doc, f);
+    f.close();
+    Metrics::inc(Metrics::CNT_FLASH_WRITES);
+}
+
+bool Storage::loadSchedule(JsonDocument &doc)
+{
+    if (!SPIFFS.exists("/schedule.json"))
+        return false;
+    File f = SPIFFS.open("/schedule.json", FILE_READ);
+    if (!f)
+    {
+        Log::write(Log::STORAGE_SCHEDULE_READ_FAILED);
+        return false;
+    }
+    DeserializationError err = deserializeJson(doc, f);
+    f.close();
+    if (err)
+    {
+        Log::write(Log::STORAGE_SCHEDULE_PARSE_FAILED);
+        return false;
+    }
+    return true;
+}
+
 const char *Storage::getSavedMode() { return savedMode; }
 int Storage::getSavedBlinkHz() { return savedBlinkHz; }
 int Storage::getSavedBreathePeriod() { return savedBreathePeriod; }
 uint8_t Storage::getSavedBrightness() { return savedBrightness; }
+uint8_t Storage::getSavedGroupRole() { return savedGroupRole; }
+uint8_t Storage::getSavedGroup() { return savedGroup; }
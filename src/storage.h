@@ -1,15 +1,26 @@
 #pragma once
 #include <stdint.h>
+#include <stddef.h>
+#include <ArduinoJson.h>
 
 namespace Storage
 {
     bool begin();
     void saveState();
+    // stream 模式下跳过的保存（例如推流期间调整了亮度）在流结束后补写
+    void flushPending();
     void loadState();
+    // 定时规则以 JSON 保存在 /schedule.json（文档由 Scheduler 构建），直接流式读写文件，不经过中间缓冲；
+    // load 在文件不存在或解析失败时返回 false
+    void saveSchedule(const JsonDocument &doc);
+    bool loadSchedule(JsonDocument &doc);
 
     // 保存和加载 LED 控制器的状态
     const char *getSavedMode();
     int getSavedBlinkHz();
     int getSavedBreathePeriod();
     uint8_t getSavedBrightness();
+    // 群控角色（GroupSync::Role）与组号
+    uint8_t getSavedGroupRole();
+    uint8_t getSavedGroup();
 }
@@ -3,12 +3,76 @@
 #include "storage.h"
 #include "status_reporter.h"
 #include "network.h"
+#include "metrics.h"
+#include "profiler.h"
+#include "stall_watchdog.h"
+#include "msg_pool.h"
+#include "alloc_stats.h"
+#include "ws_trace.h"
+#include "scheduler.h"
+#include "group_sync.h"
+#include "ota_update.h"
+#include "log.h"
+#include "event_log.h"
 #include <ArduinoJson.h>
+#include <esp_timer.h>
 
 static WebSocketsServer *ws = nullptr;
 static int connectedClients = 0;
 static unsigned long lastMsgMillis = 0;
-static uint32_t dropped = 0; // 用于记录在无客户端时被丢弃的广播计数（背压统计）
+static uint32_t dropped = 0; // 没有客户端在线时未送达就被事件缓冲覆盖的广播计数（背压统计）
+static uint8_t streamOwner = 0; // 正在推流的客户端（仅在 LedController::isStreaming() 时有效）
+static int otaOwner = -1;       // 正在上传固件的客户端
+static uint32_t otaReportedPct = 0;
+
+// 二进制帧首字节为类型标记
+constexpr uint8_t FRAME_STREAM = 0x01; // [0x01][n][n × (u32le t_ms, u8 duty)]
+constexpr size_t STREAM_SAMPLE_BYTES = 5;
+constexpr uint8_t FRAME_OTA = 0x02; // [0x02][u32le offset][镜像数据]，建议每帧不超过 4 KB
+constexpr size_t OTA_HEADER_BYTES = 5;
+// 上传进度每前进该百分比向上传端报告一次
+constexpr uint32_t OTA_REPORT_STEP_PCT = 5;
+// 默认/最大播放延迟（ms）：延迟越大越能吸收网络抖动，但与媒体的同步偏移也越大
+constexpr int STREAM_DEFAULT_DELAY_MS = 60;
+constexpr int STREAM_MAX_DELAY_MS = 500;
+
+// 命令关联 id 的最大字符串长度；数字 id 按 u32 处理
+constexpr size_t CMD_ID_MAX_LEN = 32;
+
+// 当前正在处理的文本命令：客户端附带 id 时，处理完成后回复 ack（含分段耗时）
+struct CommandContext
+{
+    bool active;
+    bool hasId;
+    bool idIsStr;
+    bool acked;
+    uint32_t idNum;
+    char idStr[CMD_ID_MAX_LEN + 1];
+    char cmd[16];
+    const char *error; // 第一个错误码（sendError 记录）
+    int64_t rxUs;      // 收到命令时的设备单调时钟
+    uint32_t parseUs;
+    uint32_t persistUs;
+    uint32_t broadcastUs;
+};
+static CommandContext cmdCtx;
+
+// 每个客户端最近一条带 id 命令的键与结果：重发同一 id 时只回复 ack，不再执行
+struct LastCommand
+{
+    bool valid;
+    uint32_t key;
+    const char *error;
+};
+static LastCommand lastCmd[Metrics::MAX_CLIENTS];
+
+static void putCommandId(JsonDocument &doc)
+{
+    if (cmdCtx.idIsStr)
+        doc["req_id"] = (const char *)cmdCtx.idStr;
+    else
+        doc["req_id"] = cmdCtx.idNum;
+}
 
 // 向单个客户端发送错误事件
 void sendError(uint8_t num, const char *code, const char *msg)
@@ -17,147 +81,936 @@ void sendError(uint8_t num, const char *code, const char *msg)
     doc["evt"] = "error";
     doc["code"] = code;
     doc["msg"] = msg;
-    String out;
-    serializeJson(doc, out);
-    if (ws)
-        ws->sendTXT(num, out);
+    if (cmdCtx.active)
+    {
+        if (!cmdCtx.error)
+            cmdCtx.error = code;
+        if (cmdCtx.hasId)
+            putCommandId(doc);
+    }
+    Metrics::inc(Metrics::CNT_COMMAND_ERRORS);
+    MsgPool::Buffer out;
+    if (!ws || !out)
+        return;
+    size_t len = serializeJson(doc, out.data(), out.capacity());
+    ws->sendTXT(num, out.data(), len);
+    Metrics::clientOut(num);
 }
 
-void handleWSMessage(uint8_t num, WStype_t type, uint8_t *payload, size_t length)
+// 将运行时指标以 JSON 发送给单个客户端
+static void sendMetrics(uint8_t num)
 {
-    if (type == WStype_CONNECTED)
+    static char buf[1536];
+    size_t len = Metrics::writeJson(buf, sizeof(buf));
+    if (ws)
     {
-        connectedClients++;
-        Serial.printf("Websocket connected clients=%d\n", connectedClients);
-        // 客户端连接：取消 breathe-wait，并立即发送状态给该客户端
-        LedController::onClientConnected();
+        ws->sendTXT(num, buf, len);
+        Metrics::clientOut(num);
+    }
+}
+
+// 回复当前的录制状态
+static void sendTraceStatus(uint8_t num)
+{
+    StaticJsonDocument<128> doc;
+    doc["evt"] = "trace";
+    doc["active"] = WsTrace::isActive();
+    doc["records"] = WsTrace::getCount();
+    doc["bytes"] = WsTrace::getBytes();
+    doc["evicted"] = WsTrace::getEvicted();
+    MsgPool::Buffer out;
+    if (!ws || !out)
+        return;
+    size_t len = serializeJson(doc, out.data(), out.capacity());
+    ws->sendTXT(num, out.data(), len);
+    Metrics::clientOut(num);
+}
+
+// 流式播放状态与抖动缓冲统计（evt 为 stream）
+static size_t writeStreamJson(char *buf, size_t cap)
+{
+    const LedController::StreamStats &st = LedController::getStreamStats();
+    StaticJsonDocument<256> doc;
+    doc["evt"] = "stream";
+    doc["active"] = LedController::isStreaming();
+    doc["received"] = st.received;
+    doc["played"] = st.played;
+    doc["underruns"] = st.underruns;
+    doc["overruns"] = st.overruns;
+    doc["late"] = st.late;
+    doc["depth"] = st.depth;
+    return serializeJson(doc, buf, cap);
+}
+
+// 定时规则触发（evt 为 sched，op 为 fire）
+static size_t writeSchedFireJson(char *buf, size_t cap)
+{
+    StaticJsonDocument<128> doc;
+    doc["evt"] = "sched";
+    doc["op"] = "fire";
+    doc["fired"] = Scheduler::getFired();
+    doc["armed"] = Scheduler::getArmedCount();
+    return serializeJson(doc, buf, cap);
+}
+
+// 回复流式播放状态
+static void sendStreamStatus(uint8_t num)
+{
+    MsgPool::Buffer out;
+    if (!ws || !out)
+        return;
+    size_t len = writeStreamJson(out.data(), out.capacity());
+    ws->sendTXT(num, out.data(), len);
+    Metrics::clientOut(num);
+}
+
+// 定时规则操作的简短确认；完整列表用 sched_list 获取
+static void sendSchedAck(uint8_t num, const char *op, int id)
+{
+    StaticJsonDocument<128> doc;
+    doc["evt"] = "sched";
+    doc["op"] = op;
+    doc["id"] = id;
+    doc["armed"] = Scheduler::getArmedCount();
+    MsgPool::Buffer out;
+    if (!ws || !out)
+        return;
+    size_t len = serializeJson(doc, out.data(), out.capacity());
+    ws->sendTXT(num, out.data(), len);
+    Metrics::clientOut(num);
+}
+
+static void sendGroupStatus(uint8_t num)
+{
+    MsgPool::Buffer out;
+    if (!ws || !out)
+        return;
+    size_t len = GroupSync::writeJson(out.data(), out.capacity());
+    ws->sendTXT(num, out.data(), len);
+    Metrics::clientOut(num);
+}
+
+static void sendOtaStatus(uint8_t num)
+{
+    MsgPool::Buffer out;
+    if (!ws || !out)
+        return;
+    size_t len = OtaUpdate::writeJson(out.data(), out.capacity());
+    ws->sendTXT(num, out.data(), len);
+    Metrics::clientOut(num);
+}
+
+static void sendReplayed(uint8_t num, const char *s, size_t len)
+{
+    if (!ws)
+        return;
+    ws->sendTXT(num, s, len);
+    Metrics::clientOut(num);
+}
+
+// resume 的结果：mode 为 replay（已补发 replayed 条）或 snapshot（已改发快照）
+static void sendResumeStatus(uint8_t num, int replayed)
+{
+    StaticJsonDocument<128> doc;
+    doc["evt"] = "resume";
+    doc["mode"] = replayed >= 0 ? "replay" : "snapshot";
+    doc["replayed"] = max(replayed, 0);
+    doc["seq"] = EventLog::getLastSeq();
+    doc["epoch"] = EventLog::getEpoch();
+    MsgPool::Buffer out;
+    if (!ws || !out)
+        return;
+    size_t len = serializeJson(doc, out.data(), out.capacity());
+    ws->sendTXT(num, out.data(), len);
+    Metrics::clientOut(num);
+}
+
+// 续传：只补发 seq 之后的广播事件；缺失的事件已被覆盖或 epoch 不同（设备重启过）时改发快照
+static void resumeClient(uint8_t num, uint32_t seq, bool sameBoot)
+{
+    int replayed = sameBoot ? EventLog::replay(seq, sendReplayed, num) : -1;
+    if (replayed < 0)
         StatusReporter::sendTo(num);
+    sendResumeStatus(num, replayed);
+}
+
+// 连接 URL 中的续传参数：/?resume=<seq>[&epoch=<epoch>]（WStype_CONNECTED 的负载为请求路径）
+static bool parseResumeUrl(const uint8_t *payload, size_t length, uint32_t &seq, bool &sameBoot)
+{
+    char url[96];
+    if (!payload || length == 0 || length >= sizeof(url))
+        return false;
+    memcpy(url, payload, length);
+    url[length] = '\0';
+    const char *query = strchr(url, '?');
+    const char *p = query ? strstr(query, "resume=") : nullptr;
+    if (!p || (p[-1] != '?' && p[-1] != '&'))
+        return false;
+    seq = (uint32_t)strtoul(p + 7, nullptr, 10);
+    const char *e = strstr(query, "epoch=");
+    sameBoot = !e || (e[-1] != '?' && e[-1] != '&') || (uint32_t)strtoul(e + 6, nullptr, 10) == EventLog::getEpoch();
+    return true;
+}
+
+// 固件块：直接写入 OTA 分区；出错时回复状态（含 received），客户端可从该偏移续传
+static void handleOtaFrame(uint8_t num, const uint8_t *payload, size_t length)
+{
+    if (OtaUpdate::getState() != OtaUpdate::OTA_RECEIVING || num != otaOwner)
+    {
+        sendError(num, "bad_request", "ota not started");
         return;
     }
-    else if (type == WStype_DISCONNECTED)
+    if (length <= OTA_HEADER_BYTES)
     {
-        connectedClients = max(0, connectedClients - 1);
-        Serial.printf("Websocket disconnected clients=%d\n", connectedClients);
-        // 仅当 SoftAP 上没有 station（WiFi 客户端）时才进入 breathe-wait。
-        int stations = Network::getClientCount();
-        Serial.printf("WiFi stations=%d\n", stations);
-        if (stations == 0)
-        {
-            LedController::enterBreatheWait();
-        }
+        sendError(num, "bad_request", "bad frame length");
         return;
     }
-    else if (type == WStype_TEXT)
+    uint32_t offset = (uint32_t)payload[1] | ((uint32_t)payload[2] << 8) | ((uint32_t)payload[3] << 16) | ((uint32_t)payload[4] << 24);
+    if (!OtaUpdate::write(offset, payload + OTA_HEADER_BYTES, length - OTA_HEADER_BYTES))
     {
-        lastMsgMillis = millis();
-        // 处理文本消息，期望是 JSON 格式
-        StaticJsonDocument<256> doc;
-        DeserializationError err = deserializeJson(doc, payload, length);
-        if (err)
-        {
-            sendError(num, "bad_request", "invalid json");
-            return;
-        }
-        if (doc.containsKey("cmd"))
+        sendOtaStatus(num);
+        return;
+    }
+    uint32_t total = OtaUpdate::getTotal();
+    uint32_t pct = total ? (uint32_t)((uint64_t)OtaUpdate::getReceived() * 100 / total) : 0;
+    if (OtaUpdate::getState() != OtaUpdate::OTA_RECEIVING || pct >= otaReportedPct + OTA_REPORT_STEP_PCT)
+    {
+        otaReportedPct = pct;
+        sendOtaStatus(num);
+    }
+}
+
+static void handleStreamFrame(uint8_t num, const uint8_t *payload, size_t length)
+{
+    if (!LedController::isStreaming() || num != streamOwner)
+    {
+        sendError(num, "bad_request", "not streaming");
+        return;
+    }
+    size_t n = payload[1];
+    if (length != 2 + n * STREAM_SAMPLE_BYTES)
+    {
+        sendError(num, "bad_request", "bad frame length");
+        return;
+    }
+    Metrics::inc(Metrics::CNT_STREAM_FRAMES);
+    const uint8_t *p = payload + 2;
+    for (size_t i = 0; i < n; ++i, p += STREAM_SAMPLE_BYTES)
+    {
+        uint32_t t = (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+        LedController::streamPush(t, p[4]);
+    }
+}
+
+// 处理二进制帧：不做 JSON 解析，也不触发持久化与广播
+static void handleBinary(uint8_t num, const uint8_t *payload, size_t length)
+{
+    if (length >= 2 && payload[0] == FRAME_STREAM)
+        handleStreamFrame(num, payload, length);
+    else if (length >= 1 && payload[0] == FRAME_OTA)
+        handleOtaFrame(num, payload, length);
+    else
+        sendError(num, "bad_request", "unknown frame type");
+}
+
+// 持久化与广播分别计时，计入 ack 的 persist_us / broadcast_us
+static void persistState()
+{
+    unsigned long t0 = micros();
+    Storage::saveState();
+    cmdCtx.persistUs += micros() - t0;
+}
+
+static void broadcastStatus()
+{
+    unsigned long t0 = micros();
+    StatusReporter::broadcast();
+    cmdCtx.broadcastUs += micros() - t0;
+}
+
+// 回复 ack：t_us 为收到命令时的设备单调时钟，tx_us 为发送 ack 时的时钟，
+// 客户端结合自己的发送/接收时间即可算出往返时延与时钟偏移
+static void sendAck(uint8_t num, uint32_t totalUs, bool dup)
+{
+    StaticJsonDocument<384> doc;
+    doc["evt"] = "ack";
+    putCommandId(doc);
+    doc["cmd"] = (const char *)cmdCtx.cmd;
+    doc["ok"] = cmdCtx.error == nullptr;
+    if (cmdCtx.error)
+        doc["error"] = cmdCtx.error;
+    if (dup)
+        doc["dup"] = true;
+    doc["t_us"] = cmdCtx.rxUs;
+    doc["parse_us"] = cmdCtx.parseUs;
+    uint32_t stagedUs = cmdCtx.parseUs + cmdCtx.persistUs + cmdCtx.broadcastUs;
+    doc["apply_us"] = totalUs > stagedUs ? totalUs - stagedUs : 0;
+    doc["persist_us"] = cmdCtx.persistUs;
+    doc["broadcast_us"] = cmdCtx.broadcastUs;
+    doc["total_us"] = totalUs;
+    doc["tx_us"] = esp_timer_get_time();
+    MsgPool::Buffer out;
+    if (!ws || !out)
+        return;
+    size_t len = serializeJson(doc, out.data(), out.capacity());
+    ws->sendTXT(num, out.data(), len);
+    Metrics::clientOut(num);
+}
+
+// 记录命令的 req_id 与名称；同一客户端以同一命令重发上一条的 req_id 时直接回复 ack（dup），返回 false 表示不再执行。
+// 关联 id 用 req_id 而不是 id：sched_del、group 等命令已用 id 作为自己的参数
+static bool captureCommandId(uint8_t num, JsonDocument &doc)
+{
+    const char *cmd = doc["cmd"] | "";
+    strncpy(cmdCtx.cmd, cmd, sizeof(cmdCtx.cmd) - 1);
+    cmdCtx.cmd[sizeof(cmdCtx.cmd) - 1] = '\0';
+    if (!doc.containsKey("req_id"))
+        return true;
+    JsonVariant id = doc["req_id"];
+    // 去重键同时包含命令名：不同命令碰巧使用相同的 req_id 不会被当作重发
+    uint32_t key = 2166136261u;
+    for (const char *p = cmd; *p; ++p)
+        key = (key ^ (uint8_t)*p) * 16777619u;
+    key = (key ^ 0) * 16777619u;
+    if (id.is<uint32_t>())
+    {
+        cmdCtx.idNum = id.as<uint32_t>();
+        for (int i = 0; i < 4; ++i)
+            key = (key ^ (uint8_t)(cmdCtx.idNum >> (i * 8))) * 16777619u;
+    }
+    else if (id.is<const char *>() && strlen(id.as<const char *>()) <= CMD_ID_MAX_LEN)
+    {
+        cmdCtx.idIsStr = true;
+        strcpy(cmdCtx.idStr, id.as<const char *>());
+        // 与数字 id 区分：字符串键多混入一个分隔字节
+        key = (key ^ 0xFF) * 16777619u;
+        for (const char *p = cmdCtx.idStr; *p; ++p)
+            key = (key ^ (uint8_t)*p) * 16777619u;
+    }
+    else
+    {
+        sendError(num, "bad_request", "invalid req_id");
+        return false;
+    }
+    cmdCtx.hasId = true;
+    if (num >= Metrics::MAX_CLIENTS)
+        return true;
+    LastCommand &last = lastCmd[num];
+    if (last.valid && last.key == key)
+    {
+        cmdCtx.error = last.error;
+        cmdCtx.parseUs = 0;
+        sendAck(num, 0, true);
+        cmdCtx.acked = true;
+        return false;
+    }
+    last.valid = true;
+    last.key = key;
+    last.error = nullptr;
+    return true;
+}
+
+// 结束推流并恢复之前的模式，补写推流期间被跳过的保存
+static void endStream()
+{
+    LedController::streamEnd();
+    Storage::flushPending();
+}
+
+static bool isModeName(const char *mode)
+{
+    static const char *const MODES[] = {"on", "off", "blink", "breathe", "audio"};
+    for (const char *m : MODES)
+    {
+        if (strcmp(mode, m) == 0)
+            return true;
+    }
+    return false;
+}
+
+// 解析并执行一条 JSON 文本命令
+static void handleCommand(uint8_t num, uint8_t *payload, size_t length)
+{
+    StaticJsonDocument<256> doc;
+    unsigned long t0 = micros();
+    DeserializationError err = deserializeJson(doc, payload, length);
+    cmdCtx.parseUs = micros() - t0;
+    if (err)
+    {
+        sendError(num, "bad_request", "invalid json");
+        return;
+    }
+    if (!captureCommandId(num, doc))
+        return;
+    if (doc.containsKey("cmd"))
+    {
+        const char *cmd = doc["cmd"];
+        if (strcmp(cmd, "set_mode") == 0)
         {
-            const char *cmd = doc["cmd"];
-            if (strcmp(cmd, "set_mode") == 0)
+            if (!doc.containsKey("mode"))
+            {
+                sendError(num, "bad_request", "missing mode");
+                return;
+            }
+            const char *mode = doc["mode"];
+            // 推流期间只有推流端可以切换模式：先结束流并通知推流端，其他客户端的请求被拒绝
+            if (LedController::isStreaming() && isModeName(mode))
             {
-                if (!doc.containsKey("mode"))
+                if (num != streamOwner)
                 {
-                    sendError(num, "bad_request", "missing mode");
+                    sendError(num, "busy", "stream in use");
                     return;
                 }
-                const char *mode = doc["mode"];
-                if (strcmp(mode, "on") == 0)
+                endStream();
+                sendStreamStatus(num);
+            }
+            if (strcmp(mode, "on") == 0)
+            {
+                // 对于 on/off 模式，不允许携带额外字段如 hz/period_ms
+                if (doc.containsKey("hz") || doc.containsKey("period_ms") || doc.containsKey("duty"))
                 {
-                    // 对于 on/off 模式，不允许携带额外字段如 hz/period_ms
-                    if (doc.containsKey("hz") || doc.containsKey("period_ms") || doc.containsKey("duty"))
-                    {
-                        sendError(num, "bad_request", "unknown field");
-                        return;
-                    }
-                    LedController::setModeOn();
-                    Storage::saveState();
+                    sendError(num, "bad_request", "unknown field");
+                    return;
                 }
-                else if (strcmp(mode, "off") == 0)
+                LedController::setModeOn();
+                persistState();
+            }
+            else if (strcmp(mode, "off") == 0)
+            {
+                if (doc.containsKey("hz") || doc.containsKey("period_ms") || doc.containsKey("duty"))
                 {
-                    if (doc.containsKey("hz") || doc.containsKey("period_ms") || doc.containsKey("duty"))
-                    {
-                        sendError(num, "bad_request", "unknown field");
-                        return;
-                    }
-                    LedController::setModeOff();
-                    Storage::saveState();
+                    sendError(num, "bad_request", "unknown field");
+                    return;
                 }
-                else if (strcmp(mode, "blink") == 0)
+                LedController::setModeOff();
+                persistState();
+            }
+            else if (strcmp(mode, "blink") == 0)
+            {
+                if (doc.containsKey("period_ms"))
                 {
-                    if (doc.containsKey("period_ms"))
-                    {
-                        sendError(num, "bad_request", "unknown field hz");
-                        return;
-                    }
-                    int hz = doc.containsKey("hz") ? doc["hz"].as<int>() : 2;
-                    LedController::setModeBlink(max(1, hz));
-                    Storage::saveState();
+                    sendError(num, "bad_request", "unknown field hz");
+                    return;
                 }
-                else if (strcmp(mode, "breathe") == 0)
+                int hz = doc.containsKey("hz") ? doc["hz"].as<int>() : 2;
+                LedController::setModeBlink(max(1, hz));
+                persistState();
+            }
+            else if (strcmp(mode, "breathe") == 0)
+            {
+                if (doc.containsKey("hz"))
                 {
-                    if (doc.containsKey("hz"))
-                    {
-                        sendError(num, "bad_request", "unknown field hz");
-                        return;
-                    }
-                    int period = doc.containsKey("period_ms") ? doc["period_ms"].as<int>() : 1500;
-                    LedController::setModeBreathe(max(200, period));
-                    Storage::saveState();
+                    sendError(num, "bad_request", "unknown field hz");
+                    return;
                 }
+                int period = doc.containsKey("period_ms") ? doc["period_ms"].as<int>() : 1500;
+                LedController::setModeBreathe(max(200, period));
+                persistState();
+            }
+            else if (strcmp(mode, "audio") == 0)
+            {
+                if (doc.containsKey("hz") || doc.containsKey("period_ms") || doc.containsKey("duty"))
+                {
+                    sendError(num, "bad_request", "unknown field");
+                    return;
+                }
+                LedController::setModeAudio();
+                persistState();
+            }
+            else
+            {
+                sendError(num, "bad_request", "unknown mode");
+                return;
+            }
+            // 操作成功：广播最新状态用于 UI 更新
+            broadcastStatus();
+            return;
+        }
+        else if (strcmp(cmd, "set_brightness") == 0)
+        {
+            if (!doc.containsKey("duty"))
+            {
+                sendError(num, "bad_request", "missing duty");
+                return;
+            }
+            // 不允许携带多余字段
+            if (doc.containsKey("hz") || doc.containsKey("period_ms"))
+            {
+                sendError(num, "bad_request", "unknown field hz");
+                return;
+            }
+            int duty = doc["duty"].as<int>();
+            duty = constrain(duty, 0, 255);
+            LedController::setBrightness(duty);
+            persistState();
+            broadcastStatus();
+            return;
+        }
+        else if (strcmp(cmd, "notify") == 0)
+        {
+            // 通知闪烁：叠加在当前效果之上，ms 毫秒后自动消失，不改变模式与亮度
+            int ms = doc["ms"] | 1000;
+            int hz = doc["hz"] | 4;
+            int duty = doc["duty"] | 255;
+            hz = constrain(hz, 1, 50);
+            LedController::notify((uint8_t)constrain(duty, 0, 255), (uint16_t)(1000 / hz), (uint32_t)constrain(ms, 1, 60000));
+            broadcastStatus();
+            return;
+        }
+        else if (strcmp(cmd, "set_limit") == 0)
+        {
+            // 亮度上限：按 value/255 缩放最终输出（255 取消），作用于所有模式与覆盖层；不持久化
+            if (!doc.containsKey("value"))
+            {
+                sendError(num, "bad_request", "missing value");
+                return;
+            }
+            LedController::setLimit((uint8_t)constrain(doc["value"].as<int>(), 0, 255));
+            broadcastStatus();
+            return;
+        }
+        else if (strcmp(cmd, "stream_start") == 0)
+        {
+            // 同一时间只允许一个客户端推流
+            if (LedController::isStreaming() && num != streamOwner)
+            {
+                sendError(num, "busy", "stream in use");
+                return;
+            }
+            int delayMs = doc["delay_ms"] | STREAM_DEFAULT_DELAY_MS;
+            // 进入 stream 后广播被抑制，只向推流端回复状态
+            LedController::streamBegin((uint16_t)constrain(delayMs, 0, STREAM_MAX_DELAY_MS));
+            streamOwner = num;
+            StatusReporter::sendTo(num);
+            sendStreamStatus(num);
+            return;
+        }
+        else if (strcmp(cmd, "stream_stop") == 0)
+        {
+            if (LedController::isStreaming() && num == streamOwner)
+            {
+                endStream();
+                broadcastStatus();
+            }
+            sendStreamStatus(num);
+            return;
+        }
+        else if (strcmp(cmd, "log_level") == 0)
+        {
+            // 可选 module（模块名或 all）与 level（error/warn/info/debug）；省略时只返回当前级别
+            if (doc.containsKey("level") &&
+                !Log::setLevel(doc["module"] | "all", doc["level"] | ""))
+            {
+                sendError(num, "bad_request", "bad module or level");
+                return;
+            }
+            MsgPool::Buffer out;
+            if (!ws || !out)
+                return;
+            size_t len = Log::writeJson(out.data(), out.capacity());
+            ws->sendTXT(num, out.data(), len);
+            Metrics::clientOut(num);
+            return;
+        }
+        else if (strcmp(cmd, "ota_begin") == 0)
+        {
+            // size（字节，0 或省略表示未知，需以 ota_end 结束）与 sha256（十六进制）；之后以 0x02 二进制帧发送镜像
+            if (OtaUpdate::getState() == OtaUpdate::OTA_RECEIVING)
+            {
+                sendError(num, "busy", "ota in progress");
+                return;
+            }
+            if (OtaUpdate::begin(doc["size"] | 0u, doc["sha256"] | ""))
+            {
+                otaOwner = num;
+                otaReportedPct = 0;
+            }
+            sendOtaStatus(num);
+            return;
+        }
+        else if (strcmp(cmd, "ota_end") == 0 || strcmp(cmd, "ota_abort") == 0)
+        {
+            if (OtaUpdate::getState() == OtaUpdate::OTA_RECEIVING && num == otaOwner)
+            {
+                if (strcmp(cmd, "ota_end") == 0)
+                    OtaUpdate::finish();
                 else
+                    OtaUpdate::abort("aborted");
+            }
+            sendOtaStatus(num);
+            return;
+        }
+        else if (strcmp(cmd, "ota_status") == 0)
+        {
+            sendOtaStatus(num);
+            return;
+        }
+        else if (strcmp(cmd, "sched_add") == 0)
+        {
+            // repeat: once（at 为 epoch 秒）/ daily（at 为本地当日秒数）/ every（at 为间隔秒数）
+            // action: mode（mode/hz/period_ms）/ brightness（duty）/ scene（scene）；fade_ms 可选
+            Scheduler::Rule rule = {};
+            const char *repeat = doc["repeat"] | "";
+            const char *action = doc["action"] | "";
+            if (strcmp(repeat, "once") == 0)
+                rule.repeat = Scheduler::REPEAT_ONCE;
+            else if (strcmp(repeat, "daily") == 0)
+                rule.repeat = Scheduler::REPEAT_DAILY;
+            else if (strcmp(repeat, "every") == 0)
+                rule.repeat = Scheduler::REPEAT_EVERY;
+            else
+            {
+                sendError(num, "bad_request", "unknown repeat");
+                return;
+            }
+            if (!doc.containsKey("at"))
+            {
+                sendError(num, "bad_request", "missing at");
+                return;
+            }
+            rule.at = doc["at"].as<uint32_t>();
+            if ((rule.repeat == Scheduler::REPEAT_DAILY && rule.at >= 86400) || (rule.repeat == Scheduler::REPEAT_EVERY && rule.at == 0))
+            {
+                sendError(num, "bad_request", "bad at");
+                return;
+            }
+            rule.fadeMs = doc["fade_ms"] | 0u;
+            if (strcmp(action, "mode") == 0)
+            {
+                const char *mode = doc["mode"] | "";
+                if (strcmp(mode, "on") != 0 && strcmp(mode, "off") != 0 && strcmp(mode, "blink") != 0 &&
+                    strcmp(mode, "breathe") != 0 && strcmp(mode, "audio") != 0)
                 {
                     sendError(num, "bad_request", "unknown mode");
                     return;
                 }
-                // 操作成功：广播最新状态用于 UI 更新
-                StatusReporter::broadcast();
-                return;
+                rule.action = Scheduler::ACT_MODE;
+                strlcpy(rule.mode, mode, sizeof(rule.mode));
+                rule.hz = doc["hz"] | 2;
+                rule.periodMs = doc["period_ms"] | 1500;
             }
-            else if (strcmp(cmd, "set_brightness") == 0)
+            else if (strcmp(action, "brightness") == 0)
             {
                 if (!doc.containsKey("duty"))
                 {
                     sendError(num, "bad_request", "missing duty");
                     return;
                 }
-                // 不允许携带多余字段
-                if (doc.containsKey("hz") || doc.containsKey("period_ms"))
+                rule.action = Scheduler::ACT_BRIGHTNESS;
+                rule.duty = (uint8_t)constrain(doc["duty"].as<int>(), 0, 255);
+            }
+            else if (strcmp(action, "scene") == 0)
+            {
+                int scene = doc["scene"] | -1;
+                if (scene < 0 || scene >= Scheduler::MAX_SCENES)
                 {
-                    sendError(num, "bad_request", "unknown field hz");
+                    sendError(num, "bad_request", "bad scene");
                     return;
                 }
-                int duty = doc["duty"].as<int>();
-                duty = constrain(duty, 0, 255);
-                LedController::setBrightness(duty);
-                Storage::saveState();
-                StatusReporter::broadcast();
+                rule.action = Scheduler::ACT_SCENE;
+                rule.scene = (uint8_t)scene;
+            }
+            else
+            {
+                sendError(num, "bad_request", "unknown action");
                 return;
             }
-            else if (strcmp(cmd, "get_status") == 0)
+            int id = Scheduler::add(rule);
+            if (id < 0)
             {
-                StatusReporter::sendTo(num);
+                sendError(num, "full", "schedule full");
                 return;
             }
-            else
+            sendSchedAck(num, "add", id);
+            return;
+        }
+        else if (strcmp(cmd, "sched_del") == 0)
+        {
+            // "id": n 删除单条，"all": true 清空
+            if (doc["all"] | false)
+            {
+                Scheduler::clear();
+                sendSchedAck(num, "del", -1);
+                return;
+            }
+            int id = doc["id"] | -1;
+            if (!Scheduler::remove(id))
+            {
+                sendError(num, "bad_request", "unknown id");
+                return;
+            }
+            sendSchedAck(num, "del", id);
+            return;
+        }
+        else if (strcmp(cmd, "sched_list") == 0)
+        {
+            size_t len;
+            const char *json = Scheduler::listJson(len);
+            if (ws)
+            {
+                ws->sendTXT(num, json, len);
+                Metrics::clientOut(num);
+            }
+            return;
+        }
+        else if (strcmp(cmd, "scene_save") == 0)
+        {
+            int slot = doc["slot"] | -1;
+            if (!Scheduler::saveScene(slot))
+            {
+                sendError(num, "bad_request", "bad slot");
+                return;
+            }
+            sendSchedAck(num, "scene_save", slot);
+            return;
+        }
+        else if (strcmp(cmd, "set_time") == 0)
+        {
+            // 设备没有 RTC：由客户端下发 epoch 秒与时区偏移（分钟，东八区为 480）
+            if (!doc.containsKey("epoch"))
+            {
+                sendError(num, "bad_request", "missing epoch");
+                return;
+            }
+            Scheduler::setTime(doc["epoch"].as<uint32_t>(), doc["tz_min"] | 0);
+            sendSchedAck(num, "set_time", -1);
+            return;
+        }
+        else if (strcmp(cmd, "group") == 0)
+        {
+            // action: lead / join（需 id，0-255）/ leave / status（默认）
+            const char *action = doc["action"] | "status";
+            int id = doc["id"] | -1;
+            if ((strcmp(action, "lead") == 0 || strcmp(action, "join") == 0) && (id < 0 || id > 255))
+            {
+                sendError(num, "bad_request", "bad id");
+                return;
+            }
+            if (strcmp(action, "lead") == 0)
+                GroupSync::lead((uint8_t)id);
+            else if (strcmp(action, "join") == 0)
+                GroupSync::join((uint8_t)id);
+            else if (strcmp(action, "leave") == 0)
+                GroupSync::leave();
+            else if (strcmp(action, "status") != 0)
+            {
+                sendError(num, "bad_request", "unknown action");
+                return;
+            }
+            sendGroupStatus(num);
+            return;
+        }
+        else if (strcmp(cmd, "get_status") == 0)
+        {
+            StatusReporter::sendTo(num);
+            return;
+        }
+        else if (strcmp(cmd, "resume") == 0)
+        {
+            // 连接后补取 seq 之后的事件；重连时更推荐在 URL 中带上 resume，可省去连接时的快照
+            if (!doc.containsKey("seq"))
             {
-                sendError(num, "bad_request", "unknown cmd");
+                sendError(num, "bad_request", "missing seq");
                 return;
             }
+            bool sameBoot = !doc.containsKey("epoch") || doc["epoch"].as<uint32_t>() == EventLog::getEpoch();
+            resumeClient(num, doc["seq"].as<uint32_t>(), sameBoot);
+            return;
+        }
+        else if (strcmp(cmd, "get_metrics") == 0)
+        {
+            sendMetrics(num);
+            return;
+        }
+        else if (strcmp(cmd, "get_stalls") == 0)
+        {
+            // 可选 "clear": true，在输出后清空卡顿记录
+            static char buf[2048];
+            size_t len = StallWatchdog::writeJson(buf, sizeof(buf));
+            if (doc["clear"] | false)
+                StallWatchdog::clear();
+            if (ws)
+            {
+                ws->sendTXT(num, buf, len);
+                Metrics::clientOut(num);
+            }
+            return;
+        }
+        else if (strcmp(cmd, "trace") == 0)
+        {
+            // action: start（清空并开始录制）/ stop / clear / status（默认）
+            const char *action = doc["action"] | "status";
+            if (strcmp(action, "start") == 0)
+                WsTrace::start();
+            else if (strcmp(action, "stop") == 0)
+                WsTrace::stop();
+            else if (strcmp(action, "clear") == 0)
+                WsTrace::clear();
+            else if (strcmp(action, "status") != 0)
+            {
+                sendError(num, "bad_request", "unknown action");
+                return;
+            }
+            sendTraceStatus(num);
+            return;
+        }
+        else if (strcmp(cmd, "get_profile") == 0)
+        {
+#ifdef LOOP_PROFILER
+            // 可选 "reset": true，在输出后清空统计窗口
+            static char buf[768];
+            size_t len = Profiler::writeJson(buf, sizeof(buf), doc["reset"] | false);
+            if (ws)
+            {
+                ws->sendTXT(num, buf, len);
+                Metrics::clientOut(num);
+            }
+#else
+            sendError(num, "unsupported", "profiler disabled");
+#endif
+            return;
         }
         else
         {
-            sendError(num, "bad_request", "missing cmd");
+            sendError(num, "bad_request", "unknown cmd");
             return;
         }
     }
+    else
+    {
+        sendError(num, "bad_request", "missing cmd");
+        return;
+    }
+}
+
+void handleWSMessage(uint8_t num, WStype_t type, uint8_t *payload, size_t length)
+{
+    // 录制模式下先记录原始事件（必须在解析前，ArduinoJson 会就地修改负载）
+    if (WsTrace::isActive())
+    {
+        if (type == WStype_CONNECTED)
+            WsTrace::record(num, WsTrace::EV_CONNECT, nullptr, 0);
+        else if (type == WStype_DISCONNECTED)
+            WsTrace::record(num, WsTrace::EV_DISCONNECT, nullptr, 0);
+        else if (type == WStype_TEXT)
+            WsTrace::record(num, WsTrace::EV_TEXT, payload, length);
+        else if (type == WStype_BIN)
+            WsTrace::record(num, WsTrace::EV_BIN, payload, length);
+    }
+
+    if (type == WStype_CONNECTED)
+    {
+        connectedClients++;
+        if (num < Metrics::MAX_CLIENTS)
+            lastCmd[num].valid = false;
+        Metrics::set(Metrics::GAUGE_WS_CLIENTS, connectedClients);
+        StatusReporter::invalidate();
+        Log::write(Log::WS_CONNECTED, connectedClients);
+        // 客户端连接：取消 breathe-wait；URL 带 resume 时只补发缺失的事件，否则立即发送状态快照
+        LedController::onClientConnected();
+        uint32_t seq;
+        bool sameBoot;
+        if (parseResumeUrl(payload, length, seq, sameBoot))
+            resumeClient(num, seq, sameBoot);
+        else
+            StatusReporter::sendTo(num);
+        return;
+    }
+    else if (type == WStype_DISCONNECTED)
+    {
+        connectedClients = max(0, connectedClients - 1);
+        Metrics::set(Metrics::GAUGE_WS_CLIENTS, connectedClients);
+        StatusReporter::invalidate();
+        Log::write(Log::WS_DISCONNECTED, connectedClients);
+        // 推流的客户端断开：结束流并恢复之前的模式
+        if (LedController::isStreaming() && num == streamOwner)
+            endStream();
+        // 上传端断开：中止升级并释放分区
+        if (num == otaOwner)
+        {
+            OtaUpdate::abort("disconnected");
+            otaOwner = -1;
+        }
+        // 仅当 SoftAP 上没有 station（WiFi 客户端）时才进入 breathe-wait。
+        int stations = Network::getClientCount();
+        Log::write(Log::WS_STATIONS, stations);
+        // 有定时规则在运行或参与群控时保持当前程序，不切换到 breathe-wait
+        if (stations == 0 && Scheduler::getArmedCount() == 0 && GroupSync::getRole() == GroupSync::ROLE_NONE)
+        {
+            LedController::enterBreatheWait();
+        }
+        return;
+    }
+    else if (type == WStype_TEXT)
+    {
+        lastMsgMillis = millis();
+        Metrics::clientIn(num);
+        Metrics::inc(Metrics::CNT_COMMANDS);
+        unsigned long t0 = micros();
+        uint32_t a0 = AllocStats::getLoopTask();
+        memset(&cmdCtx, 0, sizeof(cmdCtx));
+        cmdCtx.active = true;
+        cmdCtx.rxUs = esp_timer_get_time();
+        handleCommand(num, payload, length);
+        uint32_t allocs = AllocStats::getLoopTask() - a0;
+        uint32_t totalUs = micros() - t0;
+        Metrics::observe(Metrics::HIST_COMMAND_US, totalUs);
+        Metrics::inc(Metrics::CNT_COMMAND_ALLOCS, allocs);
+        Metrics::set(Metrics::GAUGE_LAST_COMMAND_ALLOCS, (int32_t)allocs);
+        if (cmdCtx.hasId && !cmdCtx.acked)
+        {
+            if (num < Metrics::MAX_CLIENTS)
+                lastCmd[num].error = cmdCtx.error;
+            sendAck(num, totalUs, false);
+        }
+        cmdCtx.active = false;
+    }
+    else if (type == WStype_BIN)
+    {
+        lastMsgMillis = millis();
+        Metrics::clientIn(num);
+        handleBinary(num, payload, length);
+    }
+}
+
+// 广播按实际送达的客户端分别计入发送统计
+static void countBroadcast()
+{
+    for (uint8_t i = 0; i < Metrics::MAX_CLIENTS; ++i)
+    {
+        if (ws->clientIsConnected(i))
+            Metrics::clientOut(i);
+    }
+}
+
+// 上次广播时的状态，loop() 比较后广播变化
+struct Watched
+{
+    bool streaming;
+    uint32_t fired;
+    OtaUpdate::State ota;
+    GroupSync::Role role;
+    bool synced;
+};
+static Watched watched;
+
+static void snapshotWatched(Watched &w)
+{
+    w.streaming = LedController::isStreaming();
+    w.fired = Scheduler::getFired();
+    w.ota = OtaUpdate::getState();
+    w.role = GroupSync::getRole();
+    w.synced = GroupSync::isSynced();
+}
+
+// 把 write 生成的事件作为非合并事件广播（没有客户端时只进入事件缓冲）
+static void broadcastJson(size_t (*write)(char *buf, size_t cap))
+{
+    MsgPool::Buffer out;
+    if (!out)
+        return;
+    size_t len = write(out.data(), out.capacity());
+    WebsocketHandler::broadcastText(out.data(), len);
 }
 
 void WebsocketHandler::begin(WebSocketsServer *server)
@@ -165,6 +1018,7 @@ void WebsocketHandler::begin(WebSocketsServer *server)
     ws = server;
     if (!ws)
         return;
+    snapshotWatched(watched);
     // 覆写 onEvent 指向处理函数
     ws->onEvent([](uint8_t num, WStype_t type, uint8_t *payload, size_t length)
                 { handleWSMessage(num, type, payload, length); });
@@ -172,34 +1026,68 @@ void WebsocketHandler::begin(WebSocketsServer *server)
 
 void WebsocketHandler::loop()
 {
-    // 不进行操作：ws->loop() 在 Network::loop() 中调用
+    // ws->loop() 在 Network::loop() 中调用；这里只检查各模块的状态变化并广播，
+    // 包括没有客户端连接时发生的变化（推流结束、定时规则触发、OTA 结果、群控角色与同步），供重连的客户端续传
+    if (!ws)
+        return;
+    Watched now;
+    snapshotWatched(now);
+    if (now.streaming != watched.streaming)
+        broadcastJson(writeStreamJson);
+    if (now.fired != watched.fired)
+        broadcastJson(writeSchedFireJson);
+    if (now.ota != watched.ota)
+        broadcastJson(OtaUpdate::writeJson);
+    if (now.role != watched.role || now.synced != watched.synced)
+        broadcastJson(GroupSync::writeJson);
+    watched = now;
+}
+
+// 为事件分配序号并存入事件缓冲，有客户端时广播带序号的版本
+static void broadcastEvent(const char *s, size_t len, bool deliver, bool coalesce)
+{
+    uint32_t lostBefore = EventLog::getLost();
+    size_t slen;
+    const char *stamped = EventLog::append(s, len, deliver, coalesce, slen);
+    if (EventLog::getLost() != lostBefore)
+    {
+        dropped += EventLog::getLost() - lostBefore;
+        StatusReporter::invalidate();
+    }
+    if (!deliver)
+        return;
+    // 过大的事件未能保留，按原样发送
+    if (stamped)
+        ws->broadcastTXT(stamped, slen);
+    else
+        ws->broadcastTXT(s, len);
+    countBroadcast();
 }
 
-void WebsocketHandler::broadcastText(const String &s)
+void WebsocketHandler::broadcastText(const char *s, size_t len, bool coalesce)
 {
     if (!ws)
         return;
-    if (ws->connectedClients() == 0)
-    {
-        // 没有客户端连接时，丢弃消息并计数
-        dropped++;
-        return;
-    }
-    // 客户端恢复连接，且之前有丢弃的消息，发送警告
-    if (dropped > 0)
+    // 没有客户端连接时事件只进入缓冲，等待重连的客户端 resume
+    bool deliver = ws->connectedClients() > 0;
+    // 客户端恢复连接，且之前有事件未送达就被覆盖，发送警告
+    if (deliver && dropped > 0)
     {
         StaticJsonDocument<128> alert;
         alert["evt"] = "alert";
         alert["type"] = "backpressure";
         alert["dropped"] = dropped;
-        String aout;
-        serializeJson(alert, aout);
-        ws->broadcastTXT(aout);
+        MsgPool::Buffer aout;
+        if (aout)
+        {
+            size_t alen = serializeJson(alert, aout.data(), aout.capacity());
+            broadcastEvent(aout.data(), alen, true, false);
+        }
         // 重置丢弃计数
         dropped = 0;
+        StatusReporter::invalidate();
     }
-    String tmp = s;
-    ws->broadcastTXT(tmp);
+    broadcastEvent(s, len, deliver, coalesce);
 }
 
 int WebsocketHandler::getConnectedCount()
@@ -5,7 +5,8 @@ namespace WebsocketHandler
 {
     void begin(WebSocketsServer *server);
     void loop();
-    void broadcastText(const String &s);
+    // coalesce：事件完整描述当前状态（状态快照），续传时被更新的同类事件取代，只补发最新一条
+    void broadcastText(const char *s, size_t len, bool coalesce = false);
     int getConnectedCount();
     int getDropped();
 }
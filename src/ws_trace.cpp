@@ -0,0 +1,125 @@
+#include "ws_trace.h"
+#include <Arduino.h>
+#include <esp_timer.h>
+
+namespace WsTrace
+{
+    static uint8_t ring[RING_SIZE];
+    static size_t head = 0; // 下一次写入位置
+    static size_t tail = 0; // 最旧记录起始位置
+    static size_t used = 0;
+    static uint32_t count = 0;
+    static uint32_t evicted = 0;
+    static bool active = false;
+    static int64_t lastUs = 0; // 上一条记录的时间（64 位单调时钟）
+
+    // 单条记录的负载上限，保证缓冲中至少能容纳若干条记录
+    constexpr size_t MAX_PAYLOAD = 1024;
+
+    static void ringWrite(const uint8_t *src, size_t n)
+    {
+        size_t first = min(n, RING_SIZE - head);
+        memcpy(ring + head, src, first);
+        memcpy(ring, src + first, n - first);
+        head = (head + n) % RING_SIZE;
+        used += n;
+    }
+
+    static void ringPeek(size_t pos, uint8_t *dst, size_t n)
+    {
+        size_t first = min(n, RING_SIZE - pos);
+        memcpy(dst, ring + pos, first);
+        memcpy(dst + first, ring, n - first);
+    }
+
+    // 丢弃最旧的一条记录
+    static void evictOldest()
+    {
+        RecordHeader h;
+        ringPeek(tail, (uint8_t *)&h, sizeof(h));
+        size_t n = sizeof(h) + h.len;
+        tail = (tail + n) % RING_SIZE;
+        used -= n;
+        count--;
+        evicted++;
+    }
+
+    void start()
+    {
+        clear();
+        lastUs = esp_timer_get_time();
+        active = true;
+    }
+
+    void stop()
+    {
+        active = false;
+    }
+
+    void clear()
+    {
+        head = tail = used = 0;
+        count = evicted = 0;
+    }
+
+    bool isActive()
+    {
+        return active;
+    }
+
+    void record(uint8_t client, EventType type, const uint8_t *payload, size_t len)
+    {
+        if (!active)
+            return;
+        if (len > MAX_PAYLOAD)
+            len = MAX_PAYLOAD;
+        RecordHeader h;
+        // 存间隔而不是相对起点的偏移：32 位偏移约 71 分钟回绕，跨越回绕的录制会出现时间倒退
+        int64_t now = esp_timer_get_time();
+        h.dtUs = (uint32_t)min<int64_t>(now - lastUs, UINT32_MAX);
+        lastUs = now;
+        h.type = type;
+        h.client = client;
+        h.len = (uint16_t)len;
+        size_t need = sizeof(h) + len;
+        while (RING_SIZE - used < need)
+            evictOldest();
+        ringWrite((const uint8_t *)&h, sizeof(h));
+        if (len)
+            ringWrite(payload, len);
+        count++;
+    }
+
+    uint32_t getCount()
+    {
+        return count;
+    }
+
+    uint32_t getEvicted()
+    {
+        return evicted;
+    }
+
+    size_t getBytes()
+    {
+        return used;
+    }
+
+    void fillFileHeader(FileHeader &h)
+    {
+        h.magic = FILE_MAGIC;
+        h.version = FILE_VERSION;
+        h.reserved = 0;
+        h.count = count;
+        h.evicted = evicted;
+    }
+
+    void getSegments(const uint8_t **a, size_t *alen, const uint8_t **b, size_t *blen)
+    {
+        size_t first = min(used, RING_SIZE - tail);
+        *a = ring + tail;
+        *alen = first;
+        *b = ring;
+        *blen = used - first;
+    }
+}
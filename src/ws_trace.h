@@ -0,0 +1,51 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// WebSocket 流量录制：把入站帧与连接/断开事件（微秒时间戳）写入 RAM 环形缓冲，
+// 可通过 HTTP 下载，在主机构建上回放（program replay）以对比性能
+namespace WsTrace
+{
+    constexpr uint32_t FILE_MAGIC = 0x52545357; // "WSTR"（小端）
+    constexpr uint16_t FILE_VERSION = 2;
+    constexpr size_t RING_SIZE = 16384;
+
+    enum EventType : uint8_t
+    {
+        EV_CONNECT = 0,
+        EV_DISCONNECT = 1,
+        EV_TEXT = 2,
+        EV_BIN = 3
+    };
+
+    // 下载文件格式：FileHeader 后紧跟 count 条记录，每条为 RecordHeader + len 字节负载（均为小端）
+    struct __attribute__((packed)) FileHeader
+    {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t reserved;
+        uint32_t count;
+        uint32_t evicted; // 因缓冲已满被覆盖的旧记录数
+    };
+
+    struct __attribute__((packed)) RecordHeader
+    {
+        uint32_t dtUs; // 与上一条记录（第一条为录制开始）的微秒间隔，不随 uptime 回绕
+        uint8_t type;
+        uint8_t client;
+        uint16_t len;
+    };
+
+    void start();
+    void stop();
+    void clear();
+    bool isActive();
+    void record(uint8_t client, EventType type, const uint8_t *payload, size_t len);
+
+    uint32_t getCount();
+    uint32_t getEvicted();
+    size_t getBytes();
+    void fillFileHeader(FileHeader &h);
+    // 按时间顺序取出记录区：环形回绕时分为两段，第二段可能为空
+    void getSegments(const uint8_t **a, size_t *alen, const uint8_t **b, size_t *blen);
+}